@@ -2,7 +2,20 @@
 
 #include <cstdlib>
 #include <vector>
+#include <algorithm>
+#include <numeric>
 #include <stable_vector.hpp>
+#include <stable_vector_parallel.hpp>
+#include <stable_vector_simd.hpp>
+#include <stable_soa_vector.hpp>
+#include <concurrent_stable_vector.hpp>
+#include <stable_vector_io.hpp>
+#include <array>
+#include <mutex>
+#include <string>
+#include <cstdio>
+#include <fstream>
+#include <memory>
 template <typename T>
 static void populate(T& v, size_t max)
 {
@@ -28,6 +41,59 @@ static size_t measure_populate(benchmark::State& state)
     return count;
 }
 
+template <typename T>
+static size_t measure_append(benchmark::State& state)
+{
+    size_t count = 0;
+    std::vector<size_t> source;
+    populate(source, (size_t)state.range());
+    for (auto&& _ : state)
+    {
+        T t;
+        t.insert(t.end(), source.begin(), source.end());
+        benchmark::DoNotOptimize(t.back());
+        ++count;
+    }
+    return count;
+}
+
+template <typename T>
+static size_t measure_refill(benchmark::State& state)
+{
+    size_t count = 0;
+    auto max = (size_t)state.range();
+    T t;
+    for (auto&& _ : state)
+    {
+        populate(t, max);
+        count += t.size();
+        if constexpr (requires { t.clear_keep_capacity(); })
+        {
+            t.clear_keep_capacity();
+        }
+        else
+        {
+            t.clear();
+        }
+    }
+    return count;
+}
+
+template <typename T>
+static size_t measure_copy(benchmark::State& state)
+{
+    size_t count = 0;
+    T source;
+    populate(source, (size_t)state.range());
+    for (auto&& _ : state)
+    {
+        T t(source);
+        count += t.size();
+        benchmark::DoNotOptimize(t.back());
+    }
+    return count;
+}
+
 template <typename T>
 static size_t measure_destroy(benchmark::State& state)
 {
@@ -64,6 +130,23 @@ static std::size_t  measure_pop_back(benchmark::State& state)
     return sum;
 }
 
+template <typename T>
+static std::size_t measure_truncate(benchmark::State& state)
+{
+    size_t sum = 0;
+    auto max = (size_t)state.range();
+    for (auto&& _ : state)
+    {
+        state.PauseTiming();
+        T t;
+        populate(t, max);
+        state.ResumeTiming();
+        t.erase(t.begin() + static_cast<std::ptrdiff_t>(max / 2), t.end());
+        sum += t.size();
+    }
+    return sum;
+}
+
 template <typename T>
 static size_t iterate_forward(const T&  t, benchmark::State& state)
 {
@@ -93,6 +176,64 @@ static size_t iterate_backward(const T&  t, benchmark::State& state)
     return sum;
 }
 
+static size_t for_each_forward(const std::vector<size_t>& t, benchmark::State& state)
+{
+    size_t sum = 0;
+    for (auto&& _ : state)
+    {
+        std::for_each(t.begin(), t.end(), [&sum](size_t v) { sum += v; });
+    }
+    return sum;
+}
+
+static size_t for_each_forward(const stable_vector<size_t>& t, benchmark::State& state)
+{
+    size_t sum = 0;
+    for (auto&& _ : state)
+    {
+        for_each(t, [&sum](size_t v) { sum += v; });
+    }
+    return sum;
+}
+
+static size_t segments_backward(const stable_vector<size_t>& t, benchmark::State& state)
+{
+    size_t sum = 0;
+    for (auto&& _ : state)
+    {
+        for (auto segment : t.segments() | std::views::reverse)
+        {
+            for (auto i = segment.rbegin(); i != segment.rend(); ++i)
+            {
+                sum += *i;
+            }
+        }
+    }
+    return sum;
+}
+
+template <typename T>
+static size_t measure_reduce(const T& t, benchmark::State& state)
+{
+    size_t sum = 0;
+    for (auto&& _ : state)
+    {
+        sum += accumulate(t, size_t{});
+    }
+    return sum;
+}
+
+template <typename T>
+static size_t measure_parallel_reduce(const T& t, benchmark::State& state)
+{
+    size_t sum = 0;
+    for (auto&& _ : state)
+    {
+        sum += parallel_reduce(t, size_t{});
+    }
+    return sum;
+}
+
 static void populate_std_vector(benchmark::State& state)
 {
     benchmark::DoNotOptimize(measure_populate<std::vector<size_t>>(state));
@@ -103,6 +244,44 @@ static void populate_stable_vector(benchmark::State& state)
     benchmark::DoNotOptimize(measure_populate<stable_vector<size_t>>(state));
 }
 
+static void append_std_vector(benchmark::State& state)
+{
+    benchmark::DoNotOptimize(measure_append<std::vector<size_t>>(state));
+}
+
+static void append_stable_vector(benchmark::State& state)
+{
+    benchmark::DoNotOptimize(measure_append<stable_vector<size_t>>(state));
+}
+
+static void refill_std_vector(benchmark::State& state)
+{
+    benchmark::DoNotOptimize(measure_refill<std::vector<size_t>>(state));
+}
+
+static void refill_stable_vector(benchmark::State& state)
+{
+    benchmark::DoNotOptimize(measure_refill<stable_vector<size_t>>(state));
+}
+
+static void copy_std_vector(benchmark::State& state)
+{
+    benchmark::DoNotOptimize(measure_copy<std::vector<size_t>>(state));
+}
+
+static void copy_stable_vector(benchmark::State& state)
+{
+    benchmark::DoNotOptimize(measure_copy<stable_vector<size_t>>(state));
+}
+
+// With small capped blocks a copy spans many blocks, which shows whether
+// copying is linear in the number of blocks.
+static void copy_capped_stable_vector(benchmark::State& state)
+{
+    using vector = stable_vector<size_t, std::allocator<size_t>, capped_growth<1, 64>>;
+    benchmark::DoNotOptimize(measure_copy<vector>(state));
+}
+
 static void destroy_std_vector(benchmark::State& state)
 {
     benchmark::DoNotOptimize(measure_destroy<std::vector<size_t>>(state));
@@ -123,6 +302,16 @@ static void pop_back_stable_vector(benchmark::State& state)
     benchmark::DoNotOptimize(measure_pop_back<stable_vector<size_t>>(state));
 }
 
+static void truncate_std_vector(benchmark::State& state)
+{
+    benchmark::DoNotOptimize(measure_truncate<std::vector<size_t>>(state));
+}
+
+static void truncate_stable_vector(benchmark::State& state)
+{
+    benchmark::DoNotOptimize(measure_truncate<stable_vector<size_t>>(state));
+}
+
 static void iterate_forward_std_vector(benchmark::State& state)
 {
     std::vector<size_t> v;
@@ -151,14 +340,496 @@ static void iterate_backward_stable_vector(benchmark::State& state)
     benchmark::DoNotOptimize(iterate_backward(v, state));
 }
 
+static void for_each_forward_std_vector(benchmark::State& state)
+{
+    std::vector<size_t> v;
+    populate(v, (size_t)state.range());
+    benchmark::DoNotOptimize(for_each_forward(v, state));
+}
+
+static void for_each_forward_stable_vector(benchmark::State& state)
+{
+    stable_vector<size_t> v;
+    populate(v, (size_t)state.range());
+    benchmark::DoNotOptimize(for_each_forward(v, state));
+}
+
+static void segments_backward_stable_vector(benchmark::State& state)
+{
+    stable_vector<size_t> v;
+    populate(v, (size_t)state.range());
+    benchmark::DoNotOptimize(segments_backward(v, state));
+}
+
+static void reduce_stable_vector(benchmark::State& state)
+{
+    stable_vector<size_t> v;
+    populate(v, (size_t)state.range());
+    benchmark::DoNotOptimize(measure_reduce(v, state));
+}
+
+static void parallel_reduce_stable_vector(benchmark::State& state)
+{
+    stable_vector<size_t> v;
+    populate(v, (size_t)state.range());
+    benchmark::DoNotOptimize(measure_parallel_reduce(v, state));
+}
+
+template <typename T>
+static auto make_floats(benchmark::State& state) -> T
+{
+    T v;
+    for (size_t i = 0; i != (size_t)state.range(); ++i)
+    {
+        v.push_back(static_cast<float>(i % 1000));
+    }
+    return v;
+}
+
+static void sum_std_vector(benchmark::State& state)
+{
+    const auto v = make_floats<std::vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(std::accumulate(v.begin(), v.end(), 0.0f));
+    }
+}
+
+static void sum_stable_vector(benchmark::State& state)
+{
+    const auto v = make_floats<stable_vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(std::accumulate(v.begin(), v.end(), 0.0f));
+    }
+}
+
+static void simd_sum_stable_vector(benchmark::State& state)
+{
+    const auto v = make_floats<stable_vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(simd_sum(v));
+    }
+}
+
+static void find_std_vector(benchmark::State& state)
+{
+    const auto v = make_floats<std::vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(std::find(v.begin(), v.end(), -1.0f));
+    }
+}
+
+static void find_stable_vector(benchmark::State& state)
+{
+    const auto v = make_floats<stable_vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(find(v, -1.0f));
+    }
+}
+
+static void simd_find_stable_vector(benchmark::State& state)
+{
+    const auto v = make_floats<stable_vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(simd_find(v, -1.0f));
+    }
+}
+
+static void count_std_vector(benchmark::State& state)
+{
+    const auto v = make_floats<std::vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(std::count(v.begin(), v.end(), 7.0f));
+    }
+}
+
+static void count_stable_vector(benchmark::State& state)
+{
+    const auto v = make_floats<stable_vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(count(v, 7.0f));
+    }
+}
+
+static void simd_count_stable_vector(benchmark::State& state)
+{
+    const auto v = make_floats<stable_vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(simd_count(v, 7.0f));
+    }
+}
+
+static void max_std_vector(benchmark::State& state)
+{
+    const auto v = make_floats<std::vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(*std::max_element(v.begin(), v.end()));
+    }
+}
+
+static void max_stable_vector(benchmark::State& state)
+{
+    const auto v = make_floats<stable_vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(*std::max_element(v.begin(), v.end()));
+    }
+}
+
+static void simd_max_stable_vector(benchmark::State& state)
+{
+    const auto v = make_floats<stable_vector<float>>(state);
+    for (auto&& _ : state)
+    {
+        benchmark::DoNotOptimize(simd_max(v));
+    }
+}
+
+static auto random_indexes(size_t size) -> std::vector<size_t>
+{
+    std::vector<size_t> indexes(1 << 16);
+    size_t x = 12345;
+    for (auto& i : indexes)
+    {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        i = (x >> 16) % size;
+    }
+    return indexes;
+}
+
+template <typename T>
+static void measure_lookup(benchmark::State& state)
+{
+    T v;
+    populate(v, (size_t)state.range());
+    const auto indexes = random_indexes(v.size());
+    std::vector<size_t> out(indexes.size());
+    for (auto&& _ : state)
+    {
+        for (size_t i = 0; i != indexes.size(); ++i)
+        {
+            out[i] = v[indexes[i]];
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+static void lookup_std_vector(benchmark::State& state)
+{
+    measure_lookup<std::vector<size_t>>(state);
+}
+
+static void lookup_stable_vector(benchmark::State& state)
+{
+    measure_lookup<stable_vector<size_t>>(state);
+}
+
+static void gather_stable_vector(benchmark::State& state)
+{
+    stable_vector<size_t> v;
+    populate(v, (size_t)state.range());
+    const auto indexes = random_indexes(v.size());
+    std::vector<size_t> out(indexes.size());
+    for (auto&& _ : state)
+    {
+        v.gather(indexes, out.begin());
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+struct wide_row
+{
+    double value;
+    std::array<char, 192> payload;
+};
+
+static void scan_field_stable_vector(benchmark::State& state)
+{
+    stable_vector<wide_row> v;
+    for (size_t i = 0; i != (size_t)state.range(); ++i)
+    {
+        v.push_back({static_cast<double>(i), {}});
+    }
+    for (auto&& _ : state)
+    {
+        double sum = 0;
+        for (auto segment : v.segments())
+        {
+            for (const auto& row : segment)
+            {
+                sum += row.value;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+static void scan_field_stable_soa_vector(benchmark::State& state)
+{
+    stable_soa_vector<double, std::array<char, 192>> v;
+    for (size_t i = 0; i != (size_t)state.range(); ++i)
+    {
+        v.emplace_back(static_cast<double>(i), std::array<char, 192>{});
+    }
+    for (auto&& _ : state)
+    {
+        double sum = 0;
+        for (auto segment : v.segments<0>())
+        {
+            for (double value : segment)
+            {
+                sum += value;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+static auto make_dump(benchmark::State& state) -> std::unique_ptr<std::FILE, int(*)(std::FILE*)>
+{
+    std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::tmpfile(), &std::fclose);
+    dump_to(fileno(file.get()), make_floats<stable_vector<float>>(state));
+    return file;
+}
+
+static void dump_stream_stable_vector(benchmark::State& state)
+{
+    const auto v = make_floats<stable_vector<float>>(state);
+    std::ofstream out("/dev/null", std::ios::binary);
+    for (auto&& _ : state)
+    {
+        for (const float& f : v)
+        {
+            out.write(reinterpret_cast<const char*>(&f), sizeof(f));
+        }
+        out.flush();
+    }
+}
+
+static void dump_writev_stable_vector(benchmark::State& state)
+{
+    const auto v = make_floats<stable_vector<float>>(state);
+    const std::unique_ptr<std::FILE, int(*)(std::FILE*)> out(std::fopen("/dev/null", "wb"), &std::fclose);
+    for (auto&& _ : state)
+    {
+        dump_to(fileno(out.get()), v);
+    }
+}
+
+static void load_stream_stable_vector(benchmark::State& state)
+{
+    const auto file = make_dump(state);
+    for (auto&& _ : state)
+    {
+        std::rewind(file.get());
+        stable_vector<float> v;
+        float f;
+        for (size_t i = 0; i != (size_t)state.range(); ++i)
+        {
+            std::fread(&f, sizeof(f), 1, file.get());
+            v.push_back(f);
+        }
+        benchmark::DoNotOptimize(v.back());
+    }
+}
+
+static void load_readv_stable_vector(benchmark::State& state)
+{
+    const auto file = make_dump(state);
+    const auto fd = fileno(file.get());
+    for (auto&& _ : state)
+    {
+        ::lseek(fd, 0, SEEK_SET);
+        stable_vector<float> v;
+        load_from(fd, v, (size_t)state.range());
+        benchmark::DoNotOptimize(v.back());
+    }
+}
+
+static auto make_strings(benchmark::State& state) -> stable_vector<std::string>
+{
+    stable_vector<std::string> v;
+    v.resize(static_cast<size_t>(state.range()), std::string(32, 'x'));
+    return v;
+}
+
+static void copy_strings_stable_vector(benchmark::State& state)
+{
+    auto v = make_strings(state);
+    for (auto&& _ : state)
+    {
+        stable_vector<std::string> copy(v);
+        benchmark::DoNotOptimize(copy);
+        state.PauseTiming();
+        {
+            auto destroy = std::move(copy);
+        }
+        state.ResumeTiming();
+    }
+}
+
+static void parallel_copy_strings_stable_vector(benchmark::State& state)
+{
+    auto v = make_strings(state);
+    for (auto&& _ : state)
+    {
+        auto copy = parallel_copy(v);
+        benchmark::DoNotOptimize(copy);
+        state.PauseTiming();
+        {
+            auto destroy = std::move(copy);
+        }
+        state.ResumeTiming();
+    }
+}
+
+static void destroy_strings_stable_vector(benchmark::State& state)
+{
+    for (auto&& _ : state)
+    {
+        state.PauseTiming();
+        auto v = make_strings(state);
+        state.ResumeTiming();
+        v.clear();
+    }
+}
+
+static void parallel_destroy_strings_stable_vector(benchmark::State& state)
+{
+    for (auto&& _ : state)
+    {
+        state.PauseTiming();
+        auto v = make_strings(state);
+        state.ResumeTiming();
+        parallel_clear(v);
+    }
+}
+
+static void concurrent_push_back_mutex_stable_vector(benchmark::State& state)
+{
+    static stable_vector<size_t>* v;
+    static std::mutex mutex;
+    if (state.thread_index() == 0)
+    {
+        v = new stable_vector<size_t>;
+    }
+    for (auto&& _ : state)
+    {
+        std::scoped_lock lock(mutex);
+        v->push_back(1);
+    }
+    if (state.thread_index() == 0)
+    {
+        delete v;
+    }
+}
+
+static void concurrent_push_back_concurrent_stable_vector(benchmark::State& state)
+{
+    static concurrent_stable_vector<size_t>* v;
+    if (state.thread_index() == 0)
+    {
+        v = new concurrent_stable_vector<size_t>;
+    }
+    for (auto&& _ : state)
+    {
+        v->push_back(1);
+    }
+    if (state.thread_index() == 0)
+    {
+        delete v;
+    }
+}
+
+static void concurrent_push_back_sharded_stable_vector(benchmark::State& state)
+{
+    static sharded_stable_vector<size_t>* v;
+    if (state.thread_index() == 0)
+    {
+        v = new sharded_stable_vector<size_t>;
+    }
+    stable_vector<size_t>* shard = nullptr;
+    for (auto&& _ : state)
+    {
+        // v is only set once all threads have started
+        if (shard == nullptr)
+        {
+            shard = &v->local();
+        }
+        shard->push_back(1);
+    }
+    if (state.thread_index() == 0)
+    {
+        delete v;
+    }
+}
+
 BENCHMARK(populate_std_vector)->Range(2,65536);
 BENCHMARK(populate_stable_vector)->Range(2,65536);
+BENCHMARK(append_std_vector)->Range(2,65536);
+BENCHMARK(append_stable_vector)->Range(2,65536);
+BENCHMARK(refill_std_vector)->Range(2,65536);
+BENCHMARK(refill_stable_vector)->Range(2,65536);
+BENCHMARK(copy_std_vector)->Range(2,65536);
+BENCHMARK(copy_stable_vector)->Range(2,65536);
+BENCHMARK(copy_capped_stable_vector)->Range(65536,1<<21);
 BENCHMARK(destroy_std_vector)->Range(2,65536);
 BENCHMARK(destroy_stable_vector)->Range(2,65536);
 BENCHMARK(pop_back_std_vector)->Range(2,65536);
 BENCHMARK(pop_back_stable_vector)->Range(2,65536);
+BENCHMARK(truncate_std_vector)->Range(2,65536);
+BENCHMARK(truncate_stable_vector)->Range(2,65536);
 
 BENCHMARK(iterate_forward_std_vector)->Range(2,65536);
 BENCHMARK(iterate_forward_stable_vector)->Range(2,65536);
 BENCHMARK(iterate_backward_std_vector)->Range(2,65536);
 BENCHMARK(iterate_backward_stable_vector)->Range(2,65536);
+
+BENCHMARK(for_each_forward_std_vector)->Range(2,65536);
+BENCHMARK(for_each_forward_stable_vector)->Range(2,65536);
+BENCHMARK(segments_backward_stable_vector)->Range(2,65536);
+
+BENCHMARK(concurrent_push_back_mutex_stable_vector)->Iterations(1 << 20)->ThreadRange(1, 8);
+BENCHMARK(concurrent_push_back_concurrent_stable_vector)->Iterations(1 << 20)->ThreadRange(1, 8);
+BENCHMARK(concurrent_push_back_sharded_stable_vector)->Iterations(1 << 20)->ThreadRange(1, 8);
+
+BENCHMARK(reduce_stable_vector)->Range(65536,1<<24);
+BENCHMARK(parallel_reduce_stable_vector)->Range(65536,1<<24);
+BENCHMARK(sum_std_vector)->Range(2,1<<20);
+BENCHMARK(sum_stable_vector)->Range(2,1<<20);
+BENCHMARK(simd_sum_stable_vector)->Range(2,1<<20);
+BENCHMARK(find_std_vector)->Range(2,1<<20);
+BENCHMARK(find_stable_vector)->Range(2,1<<20);
+BENCHMARK(simd_find_stable_vector)->Range(2,1<<20);
+BENCHMARK(count_std_vector)->Range(2,1<<20);
+BENCHMARK(count_stable_vector)->Range(2,1<<20);
+BENCHMARK(simd_count_stable_vector)->Range(2,1<<20);
+BENCHMARK(max_std_vector)->Range(2,1<<20);
+BENCHMARK(max_stable_vector)->Range(2,1<<20);
+BENCHMARK(simd_max_stable_vector)->Range(2,1<<20);
+
+BENCHMARK(lookup_std_vector)->Range(1<<16,1<<26);
+BENCHMARK(lookup_stable_vector)->Range(1<<16,1<<26);
+BENCHMARK(gather_stable_vector)->Range(1<<16,1<<26);
+
+BENCHMARK(scan_field_stable_vector)->Range(1<<10,1<<20);
+BENCHMARK(scan_field_stable_soa_vector)->Range(1<<10,1<<20);
+
+BENCHMARK(dump_stream_stable_vector)->Range(65536,1<<22);
+BENCHMARK(dump_writev_stable_vector)->Range(65536,1<<22);
+BENCHMARK(load_stream_stable_vector)->Range(65536,1<<22);
+BENCHMARK(load_readv_stable_vector)->Range(65536,1<<22);
+
+BENCHMARK(copy_strings_stable_vector)->Range(65536,1<<22);
+BENCHMARK(parallel_copy_strings_stable_vector)->Range(65536,1<<22);
+BENCHMARK(destroy_strings_stable_vector)->Range(65536,1<<22);
+BENCHMARK(parallel_destroy_strings_stable_vector)->Range(65536,1<<22);
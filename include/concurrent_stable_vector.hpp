@@ -0,0 +1,863 @@
+#ifndef STABLE_VECTOR_CONCURRENT_STABLE_VECTOR_HPP_INCLUDED
+#define STABLE_VECTOR_CONCURRENT_STABLE_VECTOR_HPP_INCLUDED
+
+#include "stable_vector.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A stable_vector that many threads can append to at once. An append
+// claims an index with a compare-and-swap, and the block for the index is
+// installed with a compare-and-swap by whichever thread first needs it,
+// before the index is claimed. No lock is taken, and no thread waits for
+// another.
+//
+// size() is the number of elements before the first one that is not yet
+// constructed, so any element below size() can be read from any thread
+// without further synchronization. An element that is done before an
+// earlier one is marked with a bit in a bitmap that is installed with its
+// block, and is counted by the thread that finishes the earlier one.
+//
+// The allocator must be safe to use from many threads at once. Only
+// growth policies with a bounded number of blocks can be used, since the
+// block table cannot be reallocated under concurrent readers.
+template <
+    typename T,
+    typename Alloc = std::allocator<T>,
+    typename Growth = power_of_two_growth<>
+>
+class concurrent_stable_vector
+{
+    static_assert(Growth::max_blocks <= std::numeric_limits<std::size_t>::digits,
+                  "The growth policy must have a bounded number of blocks");
+public:
+    using allocator_type = Alloc;
+    using growth_policy = Growth;
+    using allocator_traits = std::allocator_traits<allocator_type>;
+    using value_type = T;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+    concurrent_stable_vector() = default;
+
+    explicit concurrent_stable_vector(allocator_type allocator);
+
+    concurrent_stable_vector(const concurrent_stable_vector&) = delete;
+    auto operator=(const concurrent_stable_vector&) -> concurrent_stable_vector& = delete;
+
+    ~concurrent_stable_vector();
+
+    // Safe to call from any number of threads at once. If an element or
+    // allocating a block throws, nothing is appended.
+    template <typename ... Ts>
+    auto emplace_back(Ts&& ... ts) -> reference
+    requires (std::is_nothrow_constructible_v<T, Ts...>
+              || (std::is_constructible_v<T, Ts...>
+                  && std::is_nothrow_move_constructible_v<T>));
+
+    auto push_back(const_reference t) -> reference
+    requires std::is_copy_constructible_v<T>
+             && std::is_nothrow_move_constructible_v<T>;
+
+    auto push_back(value_type&& t) -> reference
+    requires std::is_nothrow_move_constructible_v<T>;
+
+    // The elements at idx < size() can be read from any thread.
+    [[nodiscard]]
+    auto operator[](std::size_t idx) noexcept -> reference;
+
+    [[nodiscard]]
+    auto operator[](std::size_t idx) const noexcept -> const_reference;
+
+    [[nodiscard]]
+    auto size() const noexcept -> std::size_t;
+
+    [[nodiscard]]
+    auto empty() const noexcept -> bool;
+
+    [[nodiscard]]
+    auto get_allocator() const noexcept -> allocator_type;
+private:
+    using word = std::atomic<std::uint64_t>;
+    using word_allocator = typename allocator_traits::template rebind_alloc<word>;
+
+    static constexpr std::size_t word_bits = std::numeric_limits<std::uint64_t>::digits;
+
+    static constexpr auto ready_words(std::size_t block_id) noexcept -> std::size_t
+    {
+        return (Growth::block_size(block_id) + word_bits - 1) / word_bits;
+    }
+
+    template <typename P, typename A>
+    static auto install(std::atomic<P*>& entry, A allocator, std::size_t size) -> P*;
+
+    auto claim() -> std::size_t;
+    auto slot(std::size_t idx) noexcept -> pointer;
+    auto is_ready(std::size_t idx) const noexcept -> bool;
+    void publish(std::size_t idx) noexcept;
+
+    [[no_unique_address]] allocator_type allocator_;
+    std::atomic<std::size_t> claimed_{0};
+    std::atomic<std::size_t> published_{0};
+    std::array<std::atomic<pointer>, Growth::max_blocks> blocks_{};
+    std::array<std::atomic<word*>, Growth::max_blocks> ready_{};
+};
+
+template <typename T, typename Alloc, typename Growth>
+concurrent_stable_vector<T, Alloc, Growth>::concurrent_stable_vector(allocator_type allocator)
+    : allocator_(allocator)
+{
+}
+
+template <typename T, typename Alloc, typename Growth>
+concurrent_stable_vector<T, Alloc, Growth>::~concurrent_stable_vector()
+{
+    const auto size = published_.load(std::memory_order_acquire);
+    for (auto idx = size; idx != 0; --idx)
+    {
+        std::destroy_at(&(*this)[idx - 1]);
+    }
+    word_allocator words(allocator_);
+    for (std::size_t id = 0; id != blocks_.size(); ++id)
+    {
+        if (auto b = blocks_[id].load(std::memory_order_acquire))
+        {
+            allocator_.deallocate(b, Growth::block_size(id));
+        }
+        if (auto w = ready_[id].load(std::memory_order_acquire))
+        {
+            std::destroy_n(w, ready_words(id));
+            words.deallocate(w, ready_words(id));
+        }
+    }
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename ... Ts>
+auto concurrent_stable_vector<T, Alloc, Growth>::emplace_back(Ts&& ... ts) -> reference
+requires (std::is_nothrow_constructible_v<T, Ts...>
+          || (std::is_constructible_v<T, Ts...>
+              && std::is_nothrow_move_constructible_v<T>))
+{
+    if constexpr (std::is_nothrow_constructible_v<T, Ts...>)
+    {
+        const auto idx = claim();
+        const auto p = slot(idx);
+        std::uninitialized_construct_using_allocator<value_type>(p,
+                                                                 allocator_,
+                                                                 std::forward<Ts>(ts)...);
+        publish(idx);
+        return *p;
+    }
+    else
+    {
+        // Construct before claiming an index, so that a throwing element
+        // does not leave a hole that can never be published.
+        auto t = std::make_obj_using_allocator<value_type>(allocator_, std::forward<Ts>(ts)...);
+        return emplace_back(std::move(t));
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto concurrent_stable_vector<T, Alloc, Growth>::push_back(const_reference t) -> reference
+requires std::is_copy_constructible_v<T>
+         && std::is_nothrow_move_constructible_v<T>
+{
+    return emplace_back(t);
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto concurrent_stable_vector<T, Alloc, Growth>::push_back(value_type&& t) -> reference
+requires std::is_nothrow_move_constructible_v<T>
+{
+    return emplace_back(std::move(t));
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto concurrent_stable_vector<T, Alloc, Growth>::operator[](std::size_t idx) noexcept
+-> reference
+{
+    const auto id = Growth::block_id(idx);
+    return blocks_[id].load(std::memory_order_acquire)[idx - Growth::block_start(id)];
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto concurrent_stable_vector<T, Alloc, Growth>::operator[](std::size_t idx) const noexcept
+-> const_reference
+{
+    const auto id = Growth::block_id(idx);
+    return blocks_[id].load(std::memory_order_acquire)[idx - Growth::block_start(id)];
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto concurrent_stable_vector<T, Alloc, Growth>::size() const noexcept -> std::size_t
+{
+    return published_.load(std::memory_order_acquire);
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto concurrent_stable_vector<T, Alloc, Growth>::empty() const noexcept -> bool
+{
+    return size() == 0;
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto concurrent_stable_vector<T, Alloc, Growth>::get_allocator() const noexcept
+-> allocator_type
+{
+    return allocator_;
+}
+
+// The first thread to need a block allocates it and installs it with a
+// compare-and-swap. A thread that loses the race gives its block back and
+// uses the installed one. The entries are sequentially consistent, since
+// the bitmaps take part in the handshake of publish().
+template <typename T, typename Alloc, typename Growth> template <typename P, typename A>
+auto concurrent_stable_vector<T, Alloc, Growth>::install(std::atomic<P*>& entry,
+                                                         A allocator,
+                                                         std::size_t size)
+-> P*
+{
+    auto b = entry.load();
+    if (b == nullptr)
+    {
+        const auto allocated = allocator.allocate(size);
+        if constexpr (std::is_same_v<P, word>)
+        {
+            std::uninitialized_value_construct_n(allocated, size);
+        }
+        if (entry.compare_exchange_strong(b, allocated))
+        {
+            b = allocated;
+        }
+        else
+        {
+            std::destroy_n(allocated, size);
+            allocator.deallocate(allocated, size);
+        }
+    }
+    return b;
+}
+
+// Claims the next index, with its block and the bitmap of the block
+// installed first. An index that is claimed must be published, so the
+// allocations are done before it is, and nothing is claimed if they
+// throw. The bitmap is zeroed here too, rather than by the thread that
+// first finishes an element out of order while holding back size().
+template <typename T, typename Alloc, typename Growth>
+auto concurrent_stable_vector<T, Alloc, Growth>::claim() -> std::size_t
+{
+    auto idx = claimed_.load(std::memory_order_relaxed);
+    do
+    {
+        const auto id = Growth::block_id(idx);
+        install(ready_[id], word_allocator(allocator_), ready_words(id));
+        install(blocks_[id], allocator_, Growth::block_size(id));
+    } while (!claimed_.compare_exchange_weak(idx, idx + 1, std::memory_order_relaxed));
+    return idx;
+}
+
+// Returns where the element at a claimed idx goes.
+template <typename T, typename Alloc, typename Growth>
+auto concurrent_stable_vector<T, Alloc, Growth>::slot(std::size_t idx) noexcept -> pointer
+{
+    const auto id = Growth::block_id(idx);
+    return blocks_[id].load() + (idx - Growth::block_start(id));
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto concurrent_stable_vector<T, Alloc, Growth>::is_ready(std::size_t idx) const noexcept -> bool
+{
+    const auto id = Growth::block_id(idx);
+    const auto words = ready_[id].load();
+    const auto bit = idx - Growth::block_start(id);
+    return words != nullptr
+        && (words[bit / word_bits].load() & (std::uint64_t{1} << (bit % word_bits))) != 0;
+}
+
+// Moves the published size past idx if all elements before it are
+// published, and otherwise sets the ready bit of idx. Then moves the
+// published size past all ready elements after it. The bits, the bitmaps
+// and the published size are sequentially consistent, so of two threads
+// that finish neighbouring elements at the same time, at least one sees
+// that the other is done and moves the size past both. Were the bitmap
+// installed with weaker ordering, the thread that publishes the earlier
+// element could miss the bitmap of the later one while that thread reads
+// a stale published size, and neither would move the size on.
+template <typename T, typename Alloc, typename Growth>
+void concurrent_stable_vector<T, Alloc, Growth>::publish(std::size_t idx) noexcept
+{
+    auto published = idx;
+    if (!published_.compare_exchange_strong(published, idx + 1))
+    {
+        const auto id = Growth::block_id(idx);
+        const auto bit = idx - Growth::block_start(id);
+        ready_[id].load()[bit / word_bits].fetch_or(std::uint64_t{1} << (bit % word_bits));
+    }
+    published = published_.load();
+    while (is_ready(published))
+    {
+        if (published_.compare_exchange_weak(published, published + 1))
+        {
+            ++published;
+        }
+    }
+}
+
+// A stable_vector that one thread appends to while any number of other
+// threads read it. The writer publishes each element with a release store
+// of the size after constructing it, and installs new blocks in a table
+// that is never reallocated, so readers never take a lock or wait.
+//
+// Readers see the first size() elements. snapshot() and segments() give
+// a random access range and the blocks of the elements published when
+// they are called, and stay valid while the writer keeps appending. There
+// are no begin() and end() members, since two calls could see different
+// sizes; the begin() and end() of one snapshot() are bounded by the same
+// published size.
+//
+// Only the writer may call emplace_back() and push_back().
+template <
+    typename T,
+    typename Alloc = std::allocator<T>,
+    typename Growth = power_of_two_growth<>
+>
+class single_writer_stable_vector
+{
+    static_assert(Growth::max_blocks <= std::numeric_limits<std::size_t>::digits,
+                  "The growth policy must have a bounded number of blocks");
+
+    template <typename>
+    struct element_at;
+
+    template <typename>
+    struct block_span;
+public:
+    using allocator_type = Alloc;
+    using growth_policy = Growth;
+    using allocator_traits = std::allocator_traits<allocator_type>;
+    using value_type = T;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+    using snapshot_range = std::ranges::transform_view<std::ranges::iota_view<std::size_t, std::size_t>,
+                                                       element_at<value_type>>;
+    using const_snapshot_range = std::ranges::transform_view<std::ranges::iota_view<std::size_t, std::size_t>,
+                                                             element_at<const value_type>>;
+    using segment_range = std::ranges::transform_view<std::ranges::iota_view<std::size_t, std::size_t>,
+                                                      block_span<value_type>>;
+    using const_segment_range = std::ranges::transform_view<std::ranges::iota_view<std::size_t, std::size_t>,
+                                                            block_span<const value_type>>;
+
+    single_writer_stable_vector() = default;
+
+    explicit single_writer_stable_vector(allocator_type allocator);
+
+    single_writer_stable_vector(const single_writer_stable_vector&) = delete;
+    auto operator=(const single_writer_stable_vector&) -> single_writer_stable_vector& = delete;
+
+    ~single_writer_stable_vector();
+
+    template <typename ... Ts>
+    auto emplace_back(Ts&& ... ts) -> reference
+    requires std::is_constructible_v<T, Ts...>;
+
+    auto push_back(const_reference t) -> reference
+    requires std::is_copy_constructible_v<T>;
+
+    auto push_back(value_type&& t) -> reference
+    requires std::is_move_constructible_v<T>;
+
+    // The elements at idx < size() can be read from any thread.
+    [[nodiscard]]
+    auto operator[](std::size_t idx) noexcept -> reference;
+
+    [[nodiscard]]
+    auto operator[](std::size_t idx) const noexcept -> const_reference;
+
+    [[nodiscard]]
+    auto size() const noexcept -> std::size_t;
+
+    [[nodiscard]]
+    auto empty() const noexcept -> bool;
+
+    [[nodiscard]]
+    auto snapshot() noexcept -> snapshot_range;
+
+    [[nodiscard]]
+    auto snapshot() const noexcept -> const_snapshot_range;
+
+    [[nodiscard]]
+    auto segments() noexcept -> segment_range;
+
+    [[nodiscard]]
+    auto segments() const noexcept -> const_segment_range;
+
+    [[nodiscard]]
+    auto get_allocator() const noexcept -> allocator_type;
+private:
+    auto address(std::size_t idx) noexcept -> pointer;
+    auto address(std::size_t idx) const noexcept -> const_pointer;
+    auto used_blocks(std::size_t size) const noexcept -> std::size_t;
+
+    [[no_unique_address]] allocator_type allocator_;
+    std::atomic<std::size_t> size_{0};
+    std::array<std::atomic<pointer>, Growth::max_blocks> blocks_{};
+};
+
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+struct single_writer_stable_vector<T, Alloc, Growth>::element_at
+{
+    std::conditional_t<std::is_const_v<TT>,
+                       const single_writer_stable_vector,
+                       single_writer_stable_vector>* v_;
+
+    auto operator()(std::size_t idx) const noexcept -> TT&
+    {
+        return *v_->address(idx);
+    }
+};
+
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+struct single_writer_stable_vector<T, Alloc, Growth>::block_span
+{
+    const single_writer_stable_vector* v_;
+    std::size_t size_;
+
+    auto operator()(std::size_t id) const noexcept -> std::span<TT>
+    {
+        const auto used = size_ - Growth::block_start(id);
+        return { v_->blocks_[id].load(std::memory_order_acquire),
+                 std::min(Growth::block_size(id), used) };
+    }
+};
+
+template <typename T, typename Alloc, typename Growth>
+single_writer_stable_vector<T, Alloc, Growth>::single_writer_stable_vector(allocator_type allocator)
+    : allocator_(allocator)
+{
+}
+
+template <typename T, typename Alloc, typename Growth>
+single_writer_stable_vector<T, Alloc, Growth>::~single_writer_stable_vector()
+{
+    if constexpr (!std::is_trivially_destructible_v<value_type>)
+    {
+        for (auto segment : segments() | std::views::reverse)
+        {
+            std::destroy(segment.rbegin(), segment.rend());
+        }
+    }
+    for (std::size_t id = 0; id != blocks_.size(); ++id)
+    {
+        if (auto b = blocks_[id].load(std::memory_order_relaxed))
+        {
+            allocator_.deallocate(b, Growth::block_size(id));
+        }
+    }
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename ... Ts>
+auto single_writer_stable_vector<T, Alloc, Growth>::emplace_back(Ts&& ... ts) -> reference
+requires std::is_constructible_v<T, Ts...>
+{
+    // only the writer changes the size and the block table, so its own
+    // loads need no ordering
+    const auto idx = size_.load(std::memory_order_relaxed);
+    const auto id = Growth::block_id(idx);
+    auto b = blocks_[id].load(std::memory_order_relaxed);
+    if (b == nullptr)
+    {
+        b = allocator_.allocate(Growth::block_size(id));
+        blocks_[id].store(b, std::memory_order_release);
+    }
+    const auto p = b + (idx - Growth::block_start(id));
+    std::uninitialized_construct_using_allocator<value_type>(p,
+                                                             allocator_,
+                                                             std::forward<Ts>(ts)...);
+    size_.store(idx + 1, std::memory_order_release);
+    return *p;
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::push_back(const_reference t) -> reference
+requires std::is_copy_constructible_v<T>
+{
+    return emplace_back(t);
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::push_back(value_type&& t) -> reference
+requires std::is_move_constructible_v<T>
+{
+    return emplace_back(std::move(t));
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::operator[](std::size_t idx) noexcept
+-> reference
+{
+    return *address(idx);
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::operator[](std::size_t idx) const noexcept
+-> const_reference
+{
+    return *address(idx);
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::size() const noexcept -> std::size_t
+{
+    return size_.load(std::memory_order_acquire);
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::empty() const noexcept -> bool
+{
+    return size() == 0;
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::snapshot() noexcept -> snapshot_range
+{
+    return snapshot_range(std::views::iota(std::size_t{}, size()),
+                          element_at<value_type>{this});
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::snapshot() const noexcept
+-> const_snapshot_range
+{
+    return const_snapshot_range(std::views::iota(std::size_t{}, size()),
+                                element_at<const value_type>{this});
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::segments() noexcept -> segment_range
+{
+    const auto size = this->size();
+    return segment_range(std::views::iota(std::size_t{}, used_blocks(size)),
+                         block_span<value_type>{this, size});
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::segments() const noexcept
+-> const_segment_range
+{
+    const auto size = this->size();
+    return const_segment_range(std::views::iota(std::size_t{}, used_blocks(size)),
+                               block_span<const value_type>{this, size});
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::get_allocator() const noexcept
+-> allocator_type
+{
+    return allocator_;
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::address(std::size_t idx) noexcept -> pointer
+{
+    const auto id = Growth::block_id(idx);
+    return blocks_[id].load(std::memory_order_acquire) + (idx - Growth::block_start(id));
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::address(std::size_t idx) const noexcept
+-> const_pointer
+{
+    const auto id = Growth::block_id(idx);
+    return blocks_[id].load(std::memory_order_acquire) + (idx - Growth::block_start(id));
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto single_writer_stable_vector<T, Alloc, Growth>::used_blocks(std::size_t size) const noexcept
+-> std::size_t
+{
+    return size == 0 ? 0 : Growth::block_id(size - 1) + 1;
+}
+
+// A stable_vector per thread. Each thread that calls local() gets a shard
+// of its own to append to without contention, and the shards are read as
+// one sequence, shard by shard, through elements() and segments(), or
+// moved into a single stable_vector by merge().
+//
+// local() may be called from many threads at once. Everything else reads
+// or changes the shards, and must not run concurrently with appends.
+template <
+    typename T,
+    typename Alloc = std::allocator<T>,
+    typename Growth = power_of_two_growth<>
+>
+class sharded_stable_vector
+{
+public:
+    using shard_type = stable_vector<T, Alloc, Growth>;
+    using allocator_type = Alloc;
+    using growth_policy = Growth;
+    using value_type = T;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+private:
+    using shard_list = stable_vector<shard_type,
+                                     typename std::allocator_traits<Alloc>::template rebind_alloc<shard_type>>;
+
+    template <typename Shard>
+    struct shard_segments
+    {
+        auto operator()(Shard& shard) const noexcept
+        {
+            return shard.segments();
+        }
+    };
+public:
+    using element_range = std::ranges::join_view<std::ranges::ref_view<shard_list>>;
+    using const_element_range = std::ranges::join_view<std::ranges::ref_view<const shard_list>>;
+    using segment_range = std::ranges::join_view<
+        std::ranges::transform_view<std::ranges::ref_view<shard_list>, shard_segments<shard_type>>>;
+    using const_segment_range = std::ranges::join_view<
+        std::ranges::transform_view<std::ranges::ref_view<const shard_list>, shard_segments<const shard_type>>>;
+
+    sharded_stable_vector() = default;
+
+    explicit sharded_stable_vector(allocator_type allocator);
+
+    sharded_stable_vector(const sharded_stable_vector&) = delete;
+    auto operator=(const sharded_stable_vector&) -> sharded_stable_vector& = delete;
+
+    // The shard of the calling thread. The reference stays valid for the
+    // life of the container, so a thread can keep it and append to it
+    // without calling local() again.
+    [[nodiscard]]
+    auto local() -> shard_type&;
+
+    [[nodiscard]]
+    auto shard_count() const noexcept -> std::size_t;
+
+    [[nodiscard]]
+    auto shard(std::size_t idx) noexcept -> shard_type&;
+
+    [[nodiscard]]
+    auto shard(std::size_t idx) const noexcept -> const shard_type&;
+
+    [[nodiscard]]
+    auto size() const noexcept -> std::size_t;
+
+    [[nodiscard]]
+    auto empty() const noexcept -> bool;
+
+    [[nodiscard]]
+    auto elements() noexcept -> element_range;
+
+    [[nodiscard]]
+    auto elements() const noexcept -> const_element_range;
+
+    [[nodiscard]]
+    auto segments() noexcept -> segment_range;
+
+    [[nodiscard]]
+    auto segments() const noexcept -> const_segment_range;
+
+    // Move all elements, in the order of elements(), into one vector and
+    // leave the shards empty. If the elements cannot throw when moved, the
+    // first shard's blocks are taken as they are, and the others are moved
+    // a block at a time. Otherwise all shards are copied, or moved if the
+    // elements cannot be copied, into a new vector, and are only cleared
+    // once it holds every element. If anything throws, every shard keeps
+    // its elements, but an element that could only be moved may be left
+    // moved-from.
+    [[nodiscard]]
+    auto merge() -> shard_type;
+
+    [[nodiscard]]
+    auto get_allocator() const noexcept -> allocator_type;
+private:
+    [[no_unique_address]] allocator_type allocator_;
+    shard_list shards_{allocator_};
+    std::vector<std::thread::id> owners_;
+    std::mutex mutex_;
+};
+
+template <typename T, typename Alloc, typename Growth>
+sharded_stable_vector<T, Alloc, Growth>::sharded_stable_vector(allocator_type allocator)
+    : allocator_(allocator)
+{
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::local() -> shard_type&
+{
+    const auto id = std::this_thread::get_id();
+    std::scoped_lock lock(mutex_);
+    const auto i = std::ranges::find(owners_, id);
+    if (i != owners_.end())
+    {
+        return shards_[static_cast<std::size_t>(i - owners_.begin())];
+    }
+    owners_.push_back(id);
+    try
+    {
+        return shards_.emplace_back();
+    }
+    catch (...)
+    {
+        owners_.pop_back();
+        throw;
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::shard_count() const noexcept -> std::size_t
+{
+    return shards_.size();
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::shard(std::size_t idx) noexcept -> shard_type&
+{
+    return shards_[idx];
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::shard(std::size_t idx) const noexcept
+-> const shard_type&
+{
+    return shards_[idx];
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::size() const noexcept -> std::size_t
+{
+    std::size_t size = 0;
+    for (const auto& shard : shards_)
+    {
+        size += shard.size();
+    }
+    return size;
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::empty() const noexcept -> bool
+{
+    return std::ranges::all_of(shards_, [](const auto& shard) { return shard.empty(); });
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::elements() noexcept -> element_range
+{
+    return element_range(std::views::all(shards_));
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::elements() const noexcept -> const_element_range
+{
+    return const_element_range(std::views::all(shards_));
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::segments() noexcept -> segment_range
+{
+    return segment_range(std::views::transform(shards_, shard_segments<shard_type>{}));
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::segments() const noexcept -> const_segment_range
+{
+    return const_segment_range(std::views::transform(shards_, shard_segments<const shard_type>{}));
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::merge() -> shard_type
+{
+    if (shards_.empty())
+    {
+        return shard_type(allocator_);
+    }
+    constexpr bool nothrow_move = std::is_nothrow_move_constructible_v<value_type>;
+    const auto append = [](shard_type& result, auto&& shards) {
+        for (auto& shard : shards)
+        {
+            for (auto segment : shard.segments())
+            {
+                if constexpr (std::is_trivially_copyable_v<value_type>
+                              || (!nothrow_move && std::is_copy_constructible_v<value_type>))
+                {
+                    result.append_range(segment);
+                }
+                else
+                {
+                    result.append_range(std::ranges::subrange(std::make_move_iterator(segment.begin()),
+                                                              std::make_move_iterator(segment.end())));
+                }
+            }
+        }
+    };
+    // The blocks are allocated as appends do, so they are not kept as
+    // reserved, and before anything is moved, so that the shards are
+    // unchanged if it throws.
+    if constexpr (nothrow_move)
+    {
+        try
+        {
+            stable_vector_detail::storage_access::allocate(shards_[0], size());
+        }
+        catch (...)
+        {
+            stable_vector_detail::storage_access::release_unused(shards_[0]);
+            throw;
+        }
+        auto result = std::move(shards_[0]);
+        shards_[0].clear();
+        append(result, shards_ | std::views::drop(1));
+        for (auto& shard : shards_)
+        {
+            shard.clear();
+        }
+        return result;
+    }
+    else
+    {
+        // an element can throw, so none leaves its shard until all are in
+        shard_type result(allocator_);
+        stable_vector_detail::storage_access::allocate(result, size());
+        append(result, shards_);
+        for (auto& shard : shards_)
+        {
+            shard.clear();
+        }
+        return result;
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto sharded_stable_vector<T, Alloc, Growth>::get_allocator() const noexcept -> allocator_type
+{
+    return allocator_;
+}
+
+namespace pmr
+{
+template <typename T, typename Growth = power_of_two_growth<>>
+using concurrent_stable_vector
+    = ::concurrent_stable_vector<T, std::pmr::polymorphic_allocator<T>, Growth>;
+
+template <typename T, typename Growth = power_of_two_growth<>>
+using single_writer_stable_vector
+    = ::single_writer_stable_vector<T, std::pmr::polymorphic_allocator<T>, Growth>;
+
+template <typename T, typename Growth = power_of_two_growth<>>
+using sharded_stable_vector
+    = ::sharded_stable_vector<T, std::pmr::polymorphic_allocator<T>, Growth>;
+}
+
+#endif //STABLE_VECTOR_CONCURRENT_STABLE_VECTOR_HPP_INCLUDED
@@ -0,0 +1,508 @@
+#ifndef STABLE_VECTOR_MAPPED_STABLE_VECTOR_HPP_INCLUDED
+#define STABLE_VECTOR_MAPPED_STABLE_VECTOR_HPP_INCLUDED
+
+#if __has_include(<sys/mman.h>)
+
+#include "stable_vector.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The header at the start of the file of a mapped_stable_vector. The
+// elements follow at data_offset, one after the other, so element n is at
+// data_offset + n * element_size whatever the growth policy, which only
+// decides how far the file grows at a time. The numbers, and the
+// elements, are stored in the byte order of the machine that wrote them,
+// which byte_order records.
+struct mapped_stable_vector_header
+{
+    static constexpr char expected_magic[8] = {'S', 'T', 'B', 'L', 'V', 'E', 'C', '\0'};
+    static constexpr std::uint32_t current_version = 3;
+    static constexpr std::uint32_t native_byte_order = 0x01020304;
+    static constexpr std::size_t data_offset = 64;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t element_size;
+    std::uint64_t size;
+    std::uint32_t element_alignment;
+    std::uint32_t byte_order;
+};
+
+// A vector of trivially copyable elements kept in a file. The file is
+// mapped into an address range that is reserved when it is opened, and
+// grows a block at a time, each new block mapped right after the ones
+// before it, so elements never move. Opening an existing file maps it,
+// and the elements are ready to use without being read or copied.
+//
+// The reserved range only takes address space, not memory, and limits
+// how large the file can grow. Growing past it throws std::length_error.
+//
+// The number of elements is stored in the header as elements are added
+// and removed. sync() writes everything to the file; otherwise the
+// system writes it back in its own time.
+template <typename T, typename Growth = power_of_two_growth<>>
+class mapped_stable_vector
+{
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "The elements of a mapped_stable_vector are stored as their bytes");
+    static_assert(alignof(T) <= mapped_stable_vector_header::data_offset,
+                  "The elements must fit the alignment of the start of the data");
+public:
+    using growth_policy = Growth;
+    using value_type = T;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+    using iterator = pointer;
+    using const_iterator = const_pointer;
+
+    static constexpr std::size_t default_max_bytes = std::size_t{1} << (sizeof(void*) == 8 ? 36 : 30);
+
+    // Opens the file at path, or creates it if it does not exist. The
+    // file can grow to max_bytes, or its size if larger, which is the
+    // address range reserved for it. Throws std::system_error if the file
+    // cannot be opened or mapped, and std::runtime_error if it holds a
+    // different type of vector or was written with another byte order.
+    explicit mapped_stable_vector(const std::filesystem::path& path,
+                                  std::size_t max_bytes = default_max_bytes);
+
+    mapped_stable_vector(mapped_stable_vector&& v) noexcept;
+
+    mapped_stable_vector(const mapped_stable_vector&) = delete;
+    auto operator=(const mapped_stable_vector&) -> mapped_stable_vector& = delete;
+    auto operator=(mapped_stable_vector&&) -> mapped_stable_vector& = delete;
+
+    ~mapped_stable_vector();
+
+    template <typename ... Ts>
+    auto emplace_back(Ts&& ... ts) -> reference
+    requires std::is_constructible_v<T, Ts...>;
+
+    auto push_back(const_reference t) -> reference;
+
+    void pop_back() noexcept;
+
+    // Removes all elements, and keeps the file at its size.
+    void clear() noexcept;
+
+    void reserve(std::size_t n);
+
+    // Writes the elements and the header to the file, and waits until it
+    // is done.
+    void sync();
+
+    [[nodiscard]]
+    auto operator[](std::size_t idx) noexcept -> reference;
+
+    [[nodiscard]]
+    auto operator[](std::size_t idx) const noexcept -> const_reference;
+
+    [[nodiscard]]
+    auto front() noexcept -> reference;
+
+    [[nodiscard]]
+    auto front() const noexcept -> const_reference;
+
+    [[nodiscard]]
+    auto back() noexcept -> reference;
+
+    [[nodiscard]]
+    auto back() const noexcept -> const_reference;
+
+    // The blocks are mapped one after the other, so the elements are
+    // contiguous.
+    [[nodiscard]]
+    auto data() noexcept -> pointer;
+
+    [[nodiscard]]
+    auto data() const noexcept -> const_pointer;
+
+    [[nodiscard]]
+    auto begin() noexcept -> iterator;
+
+    [[nodiscard]]
+    auto begin() const noexcept -> const_iterator;
+
+    [[nodiscard]]
+    auto end() noexcept -> iterator;
+
+    [[nodiscard]]
+    auto end() const noexcept -> const_iterator;
+
+    [[nodiscard]]
+    auto size() const noexcept -> std::size_t;
+
+    [[nodiscard]]
+    auto empty() const noexcept -> bool;
+
+    // The number of elements that fit in the mapped blocks.
+    [[nodiscard]]
+    auto capacity() const noexcept -> std::size_t;
+private:
+    using header_type = mapped_stable_vector_header;
+
+    auto header() const noexcept -> header_type*;
+    // Extends the file and the mapping to hold the blocks of the first n
+    // elements.
+    void map_elements(std::size_t n);
+    void map_bytes(std::size_t bytes);
+    void map_file(std::size_t file_size);
+    void close() noexcept;
+
+    static auto page_size() noexcept -> std::size_t;
+
+    [[noreturn]]
+    static void throw_errno(const char* what);
+
+    int fd_ = -1;
+    std::byte* base_ = nullptr;
+    std::size_t reserved_ = 0;
+    std::size_t mapped_ = 0;
+    std::size_t file_size_ = 0;
+    std::size_t size_ = 0;
+};
+
+template <typename T, typename Growth>
+mapped_stable_vector<T, Growth>::mapped_stable_vector(const std::filesystem::path& path, std::size_t max_bytes)
+{
+    try {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+        {
+            throw_errno("open");
+        }
+        struct stat st;
+        if (::fstat(fd_, &st) != 0)
+        {
+            throw_errno("fstat");
+        }
+        const auto file_size = static_cast<std::size_t>(st.st_size);
+        header_type h{};
+        if (file_size != 0)
+        {
+            // The header is checked before anything is mapped, so that a
+            // file that is not a vector of T is left as it is.
+            if (file_size < header_type::data_offset)
+            {
+                throw std::runtime_error("mapped_stable_vector: the file is too short for a header");
+            }
+            const auto read = ::pread(fd_, &h, sizeof(h), 0);
+            if (read < 0)
+            {
+                throw_errno("pread");
+            }
+            // the magic is bytes, so it reads the same in either byte order
+            if (static_cast<std::size_t>(read) == sizeof(h)
+                && std::memcmp(h.magic, header_type::expected_magic, sizeof(h.magic)) == 0
+                && h.byte_order == 0x04030201)
+            {
+                throw std::runtime_error("mapped_stable_vector: the file was written with another byte order");
+            }
+            if (static_cast<std::size_t>(read) != sizeof(h)
+                || std::memcmp(h.magic, header_type::expected_magic, sizeof(h.magic)) != 0
+                || h.byte_order != header_type::native_byte_order
+                || h.version != header_type::current_version
+                || h.element_size != sizeof(T)
+                || h.element_alignment != alignof(T)
+                || h.size > (file_size - header_type::data_offset) / sizeof(T))
+            {
+                throw std::runtime_error("mapped_stable_vector: the file holds a different kind of vector");
+            }
+        }
+        const auto page = page_size();
+        reserved_ = (std::max(max_bytes, file_size) + page - 1) / page * page;
+        // Reserves the address range only, without memory behind it.
+        auto p = ::mmap(nullptr, reserved_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED)
+        {
+            throw_errno("mmap");
+        }
+        base_ = static_cast<std::byte*>(p);
+        if (file_size == 0)
+        {
+            map_bytes(header_type::data_offset);
+            std::memcpy(h.magic, header_type::expected_magic, sizeof(h.magic));
+            h.version = header_type::current_version;
+            h.element_size = sizeof(T);
+            h.size = 0;
+            h.element_alignment = alignof(T);
+            h.byte_order = header_type::native_byte_order;
+            *header() = h;
+            return;
+        }
+        map_file(file_size);
+        file_size_ = file_size;
+        size_ = static_cast<std::size_t>(h.size);
+    }
+    catch (...)
+    {
+        close();
+        throw;
+    }
+}
+
+template <typename T, typename Growth>
+mapped_stable_vector<T, Growth>::mapped_stable_vector(mapped_stable_vector&& v) noexcept
+    : fd_(std::exchange(v.fd_, -1))
+    , base_(std::exchange(v.base_, nullptr))
+    , reserved_(std::exchange(v.reserved_, 0))
+    , mapped_(std::exchange(v.mapped_, 0))
+    , file_size_(std::exchange(v.file_size_, 0))
+    , size_(std::exchange(v.size_, 0))
+{
+}
+
+template <typename T, typename Growth>
+mapped_stable_vector<T, Growth>::~mapped_stable_vector()
+{
+    close();
+}
+
+template <typename T, typename Growth>
+void mapped_stable_vector<T, Growth>::close() noexcept
+{
+    if (base_ != nullptr)
+    {
+        ::munmap(base_, reserved_);
+        base_ = nullptr;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+template <typename T, typename Growth> template <typename ... Ts>
+auto mapped_stable_vector<T, Growth>::emplace_back(Ts&& ... ts) -> reference
+requires std::is_constructible_v<T, Ts...>
+{
+    map_elements(size_ + 1);
+    auto p = std::construct_at(data() + size_, std::forward<Ts>(ts)...);
+    ++size_;
+    header()->size = size_;
+    return *p;
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::push_back(const_reference t) -> reference
+{
+    return emplace_back(t);
+}
+
+template <typename T, typename Growth>
+void mapped_stable_vector<T, Growth>::pop_back() noexcept
+{
+    --size_;
+    header()->size = size_;
+}
+
+template <typename T, typename Growth>
+void mapped_stable_vector<T, Growth>::clear() noexcept
+{
+    size_ = 0;
+    header()->size = 0;
+}
+
+template <typename T, typename Growth>
+void mapped_stable_vector<T, Growth>::reserve(std::size_t n)
+{
+    map_elements(n);
+}
+
+template <typename T, typename Growth>
+void mapped_stable_vector<T, Growth>::sync()
+{
+    if (::msync(base_, mapped_, MS_SYNC) != 0)
+    {
+        throw_errno("msync");
+    }
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::operator[](std::size_t idx) noexcept -> reference
+{
+    return data()[idx];
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::operator[](std::size_t idx) const noexcept -> const_reference
+{
+    return data()[idx];
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::front() noexcept -> reference
+{
+    return data()[0];
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::front() const noexcept -> const_reference
+{
+    return data()[0];
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::back() noexcept -> reference
+{
+    return data()[size_ - 1];
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::back() const noexcept -> const_reference
+{
+    return data()[size_ - 1];
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::data() noexcept -> pointer
+{
+    return reinterpret_cast<pointer>(base_ + header_type::data_offset);
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::data() const noexcept -> const_pointer
+{
+    return reinterpret_cast<const_pointer>(base_ + header_type::data_offset);
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::begin() noexcept -> iterator
+{
+    return data();
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::begin() const noexcept -> const_iterator
+{
+    return data();
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::end() noexcept -> iterator
+{
+    return data() + size_;
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::end() const noexcept -> const_iterator
+{
+    return data() + size_;
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::size() const noexcept -> std::size_t
+{
+    return size_;
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::empty() const noexcept -> bool
+{
+    return size_ == 0;
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::capacity() const noexcept -> std::size_t
+{
+    return (file_size_ - header_type::data_offset) / sizeof(T);
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::header() const noexcept -> header_type*
+{
+    return reinterpret_cast<header_type*>(base_);
+}
+
+template <typename T, typename Growth>
+void mapped_stable_vector<T, Growth>::map_elements(std::size_t n)
+{
+    if (n <= capacity())
+    {
+        return;
+    }
+    const auto id = Growth::block_id(n - 1);
+    const auto block_end = header_type::data_offset + (Growth::block_start(id) + Growth::block_size(id)) * sizeof(T);
+    // the last block is cut short at the end of the reserved range, so
+    // that all of it can be used
+    const auto needed = header_type::data_offset + n * sizeof(T);
+    map_bytes(needed <= reserved_ ? std::min(block_end, reserved_) : needed);
+}
+
+// Grows the file to at least bytes, rounded up to whole pages, and maps
+// the new part right after the part already mapped.
+template <typename T, typename Growth>
+void mapped_stable_vector<T, Growth>::map_bytes(std::size_t bytes)
+{
+    const auto page = page_size();
+    bytes = (bytes + page - 1) / page * page;
+    if (bytes <= file_size_)
+    {
+        return;
+    }
+    if (bytes > reserved_)
+    {
+        throw std::length_error("mapped_stable_vector: the file would outgrow its reserved address range");
+    }
+    if (::ftruncate(fd_, static_cast<off_t>(bytes)) != 0)
+    {
+        throw_errno("ftruncate");
+    }
+    map_file(bytes);
+    file_size_ = bytes;
+}
+
+// Maps the pages of a file of file_size bytes that are not mapped yet. A
+// file that does not end on a page is mapped to the end of its last page
+// without being extended, so capacity() counts from the file size rather
+// than from what is mapped.
+template <typename T, typename Growth>
+void mapped_stable_vector<T, Growth>::map_file(std::size_t file_size)
+{
+    const auto page = page_size();
+    const auto bytes = (file_size + page - 1) / page * page;
+    if (bytes <= mapped_)
+    {
+        return;
+    }
+    auto p = ::mmap(base_ + mapped_, bytes - mapped_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                    fd_, static_cast<off_t>(mapped_));
+    if (p == MAP_FAILED)
+    {
+        throw_errno("mmap");
+    }
+    mapped_ = bytes;
+}
+
+template <typename T, typename Growth>
+auto mapped_stable_vector<T, Growth>::page_size() noexcept -> std::size_t
+{
+    return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+template <typename T, typename Growth>
+void mapped_stable_vector<T, Growth>::throw_errno(const char* what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+#endif
+
+#endif //STABLE_VECTOR_MAPPED_STABLE_VECTOR_HPP_INCLUDED
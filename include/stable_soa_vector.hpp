@@ -0,0 +1,441 @@
+#ifndef STABLE_VECTOR_STABLE_SOA_VECTOR_HPP_INCLUDED
+#define STABLE_VECTOR_STABLE_SOA_VECTOR_HPP_INCLUDED
+
+#include "stable_vector.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+// A stable_vector of rows with the fields Ts..., where each field is kept
+// in a stable_vector of its own. All columns have the same blocks, so a
+// row is at the same position in every column, and a scan over one field
+// only reads the memory of that field. Elements never move, so references
+// to the fields of a row stay valid when the vector grows.
+//
+// Rows are read and written through a tuple of references to the fields.
+// Alloc is rebound to the type of each column.
+template <typename Alloc, typename Growth, typename ... Ts>
+class basic_stable_soa_vector
+{
+    static_assert(sizeof...(Ts) > 0, "A stable_soa_vector needs at least one field");
+
+    template <bool Const>
+    class iterator_t;
+
+    template <typename T>
+    using column_of = stable_vector<T, typename std::allocator_traits<Alloc>::template rebind_alloc<T>, Growth>;
+public:
+    template <std::size_t I>
+    using column_type = column_of<std::tuple_element_t<I, std::tuple<Ts...>>>;
+    using allocator_type = Alloc;
+    using growth_policy = Growth;
+    using value_type = std::tuple<Ts...>;
+    using reference = std::tuple<Ts&...>;
+    using const_reference = std::tuple<const Ts&...>;
+    using iterator = iterator_t<false>;
+    using const_iterator = iterator_t<true>;
+
+    basic_stable_soa_vector() = default;
+
+    explicit basic_stable_soa_vector(allocator_type allocator);
+
+    // Appends a row with each field constructed from the argument at its
+    // position. If a field throws, the fields already constructed are
+    // removed and the vector is left as it was.
+    template <typename ... Us>
+    auto emplace_back(Us&& ... us) -> reference
+    requires (sizeof...(Us) == sizeof...(Ts) && (std::is_constructible_v<Ts, Us> && ...));
+
+    auto push_back(const value_type& row) -> reference
+    requires (std::is_copy_constructible_v<Ts> && ...);
+
+    auto push_back(value_type&& row) -> reference
+    requires (std::is_move_constructible_v<Ts> && ...);
+
+    void pop_back() noexcept;
+
+    void reserve(std::size_t n);
+
+    void clear() noexcept;
+
+    [[nodiscard]]
+    auto operator[](std::size_t idx) noexcept -> reference;
+
+    [[nodiscard]]
+    auto operator[](std::size_t idx) const noexcept -> const_reference;
+
+    [[nodiscard]]
+    auto front() noexcept -> reference;
+
+    [[nodiscard]]
+    auto front() const noexcept -> const_reference;
+
+    [[nodiscard]]
+    auto back() noexcept -> reference;
+
+    [[nodiscard]]
+    auto back() const noexcept -> const_reference;
+
+    [[nodiscard]]
+    auto size() const noexcept -> std::size_t;
+
+    [[nodiscard]]
+    auto empty() const noexcept -> bool;
+
+    [[nodiscard]]
+    auto capacity() const noexcept -> std::size_t;
+
+    [[nodiscard]]
+    auto begin() noexcept -> iterator;
+
+    [[nodiscard]]
+    auto begin() const noexcept -> const_iterator;
+
+    [[nodiscard]]
+    auto cbegin() const noexcept -> const_iterator;
+
+    [[nodiscard]]
+    auto end() noexcept -> iterator;
+
+    [[nodiscard]]
+    auto end() const noexcept -> const_iterator;
+
+    [[nodiscard]]
+    auto cend() const noexcept -> const_iterator;
+
+    // The column of field I, to read. Its elements are assigned through
+    // operator[] or segments<I>(), and rows are only added and removed
+    // through the soa vector, so that all columns keep the same size.
+    template <std::size_t I>
+    [[nodiscard]]
+    auto column() const noexcept -> const column_type<I>&;
+
+    // The blocks of field I, for scans that read or write only that field.
+    template <std::size_t I>
+    [[nodiscard]]
+    auto segments() noexcept -> typename column_type<I>::segment_range;
+
+    template <std::size_t I>
+    [[nodiscard]]
+    auto segments() const noexcept -> typename column_type<I>::const_segment_range;
+
+    [[nodiscard]]
+    auto get_allocator() const noexcept -> allocator_type;
+private:
+    [[no_unique_address]] allocator_type allocator_;
+    std::tuple<column_of<Ts>...> columns_;
+};
+
+template <typename Alloc, typename Growth, typename ... Ts> template <bool Const>
+class basic_stable_soa_vector<Alloc, Growth, Ts...>::iterator_t
+{
+    friend class basic_stable_soa_vector<Alloc, Growth, Ts...>;
+
+    using column_iterators = std::tuple<std::conditional_t<Const,
+                                                           typename column_of<Ts>::const_iterator,
+                                                           typename column_of<Ts>::iterator>...>;
+public:
+    // The reference is a tuple of references, so the iterator is a proxy
+    // iterator, and is only an input iterator to the legacy algorithms.
+    using iterator_concept = std::random_access_iterator_tag;
+    using iterator_category = std::input_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = std::tuple<Ts...>;
+    using reference = std::conditional_t<Const, std::tuple<const Ts&...>, std::tuple<Ts&...>>;
+
+    iterator_t() = default;
+
+    // an iterator converts to a const_iterator
+    template <bool C>
+    iterator_t(const iterator_t<C>& i) noexcept requires (Const && !C)
+        : iterators_(i.iterators_)
+    {
+    }
+
+    auto operator*() const noexcept -> reference
+    {
+        return std::apply([](auto& ... i) { return reference(*i...); }, iterators_);
+    }
+
+    auto operator[](difference_type n) const noexcept -> reference
+    {
+        return *(*this + n);
+    }
+
+    auto operator++() noexcept -> iterator_t&
+    {
+        std::apply([](auto& ... i) { (++i, ...); }, iterators_);
+        return *this;
+    }
+
+    auto operator++(int) noexcept -> iterator_t
+    {
+        auto copy = *this;
+        ++*this;
+        return copy;
+    }
+
+    auto operator--() noexcept -> iterator_t&
+    {
+        std::apply([](auto& ... i) { (--i, ...); }, iterators_);
+        return *this;
+    }
+
+    auto operator--(int) noexcept -> iterator_t
+    {
+        auto copy = *this;
+        --*this;
+        return copy;
+    }
+
+    auto operator+=(difference_type n) noexcept -> iterator_t&
+    {
+        std::apply([n](auto& ... i) { ((i += n), ...); }, iterators_);
+        return *this;
+    }
+
+    auto operator-=(difference_type n) noexcept -> iterator_t&
+    {
+        return *this += -n;
+    }
+
+    friend auto operator+(iterator_t i, difference_type n) noexcept -> iterator_t
+    {
+        return i += n;
+    }
+
+    friend auto operator+(difference_type n, iterator_t i) noexcept -> iterator_t
+    {
+        return i += n;
+    }
+
+    friend auto operator-(iterator_t i, difference_type n) noexcept -> iterator_t
+    {
+        return i -= n;
+    }
+
+    // all columns move together, so the first one speaks for all of them
+    friend auto operator-(const iterator_t& lh, const iterator_t& rh) noexcept -> difference_type
+    {
+        return std::get<0>(lh.iterators_) - std::get<0>(rh.iterators_);
+    }
+
+    friend auto operator==(const iterator_t& lh, const iterator_t& rh) noexcept -> bool
+    {
+        return std::get<0>(lh.iterators_) == std::get<0>(rh.iterators_);
+    }
+
+    friend auto operator<=>(const iterator_t& lh, const iterator_t& rh) noexcept -> std::strong_ordering
+    {
+        return std::get<0>(lh.iterators_) <=> std::get<0>(rh.iterators_);
+    }
+private:
+    explicit iterator_t(column_iterators iterators) noexcept
+        : iterators_(iterators)
+    {
+    }
+
+    template <bool>
+    friend class iterator_t;
+
+    column_iterators iterators_;
+};
+
+template <typename Alloc, typename Growth, typename ... Ts>
+basic_stable_soa_vector<Alloc, Growth, Ts...>::basic_stable_soa_vector(allocator_type allocator)
+    : allocator_(allocator)
+    , columns_(column_of<Ts>(allocator)...)
+{
+}
+
+template <typename Alloc, typename Growth, typename ... Ts> template <typename ... Us>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::emplace_back(Us&& ... us) -> reference
+requires (sizeof...(Us) == sizeof...(Ts) && (std::is_constructible_v<Ts, Us> && ...))
+{
+    const auto old_size = size();
+    try {
+        // the columns are appended to in order, up to the first that throws
+        std::apply([&](auto& ... column) { (column.emplace_back(std::forward<Us>(us)), ...); }, columns_);
+    }
+    catch (...)
+    {
+        std::apply([old_size](auto& ... column) {
+            ((column.size() != old_size ? column.pop_back() : void()), ...);
+        }, columns_);
+        throw;
+    }
+    return back();
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::push_back(const value_type& row) -> reference
+requires (std::is_copy_constructible_v<Ts> && ...)
+{
+    return std::apply([this](const auto& ... fields) -> reference { return emplace_back(fields...); }, row);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::push_back(value_type&& row) -> reference
+requires (std::is_move_constructible_v<Ts> && ...)
+{
+    return std::apply([this](auto&& ... fields) -> reference {
+        return emplace_back(std::move(fields)...);
+    }, row);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+void basic_stable_soa_vector<Alloc, Growth, Ts...>::pop_back() noexcept
+{
+    std::apply([](auto& ... column) { (column.pop_back(), ...); }, columns_);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+void basic_stable_soa_vector<Alloc, Growth, Ts...>::reserve(std::size_t n)
+{
+    std::apply([n](auto& ... column) { (column.reserve(n), ...); }, columns_);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+void basic_stable_soa_vector<Alloc, Growth, Ts...>::clear() noexcept
+{
+    std::apply([](auto& ... column) { (column.clear(), ...); }, columns_);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::operator[](std::size_t idx) noexcept -> reference
+{
+    return std::apply([idx](auto& ... column) { return reference(column[idx]...); }, columns_);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::operator[](std::size_t idx) const noexcept
+-> const_reference
+{
+    return std::apply([idx](const auto& ... column) { return const_reference(column[idx]...); }, columns_);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::front() noexcept -> reference
+{
+    return std::apply([](auto& ... column) { return reference(column.front()...); }, columns_);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::front() const noexcept -> const_reference
+{
+    return std::apply([](const auto& ... column) { return const_reference(column.front()...); }, columns_);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::back() noexcept -> reference
+{
+    return std::apply([](auto& ... column) { return reference(column.back()...); }, columns_);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::back() const noexcept -> const_reference
+{
+    return std::apply([](const auto& ... column) { return const_reference(column.back()...); }, columns_);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::size() const noexcept -> std::size_t
+{
+    return std::get<0>(columns_).size();
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::empty() const noexcept -> bool
+{
+    return size() == 0;
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::capacity() const noexcept -> std::size_t
+{
+    return std::apply([](const auto& ... column) { return std::min({column.capacity()...}); }, columns_);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::begin() noexcept -> iterator
+{
+    return iterator(std::apply([](auto& ... column) {
+        return typename iterator::column_iterators(column.begin()...);
+    }, columns_));
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::begin() const noexcept -> const_iterator
+{
+    return const_iterator(std::apply([](const auto& ... column) {
+        return typename const_iterator::column_iterators(column.begin()...);
+    }, columns_));
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::cbegin() const noexcept -> const_iterator
+{
+    return begin();
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::end() noexcept -> iterator
+{
+    return iterator(std::apply([](auto& ... column) {
+        return typename iterator::column_iterators(column.end()...);
+    }, columns_));
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::end() const noexcept -> const_iterator
+{
+    return const_iterator(std::apply([](const auto& ... column) {
+        return typename const_iterator::column_iterators(column.end()...);
+    }, columns_));
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::cend() const noexcept -> const_iterator
+{
+    return end();
+}
+
+template <typename Alloc, typename Growth, typename ... Ts> template <std::size_t I>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::column() const noexcept -> const column_type<I>&
+{
+    return std::get<I>(columns_);
+}
+
+template <typename Alloc, typename Growth, typename ... Ts> template <std::size_t I>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::segments() noexcept
+-> typename column_type<I>::segment_range
+{
+    return std::get<I>(columns_).segments();
+}
+
+template <typename Alloc, typename Growth, typename ... Ts> template <std::size_t I>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::segments() const noexcept
+-> typename column_type<I>::const_segment_range
+{
+    return std::get<I>(columns_).segments();
+}
+
+template <typename Alloc, typename Growth, typename ... Ts>
+auto basic_stable_soa_vector<Alloc, Growth, Ts...>::get_allocator() const noexcept -> allocator_type
+{
+    return allocator_;
+}
+
+template <typename ... Ts>
+using stable_soa_vector = basic_stable_soa_vector<std::allocator<std::byte>, power_of_two_growth<>, Ts...>;
+
+namespace pmr
+{
+template <typename ... Ts>
+using stable_soa_vector
+    = ::basic_stable_soa_vector<std::pmr::polymorphic_allocator<std::byte>, power_of_two_growth<>, Ts...>;
+}
+
+#endif //STABLE_VECTOR_STABLE_SOA_VECTOR_HPP_INCLUDED
@@ -3,22 +3,177 @@
 
 #include <utility>
 #include <bit>
+#include <compare>
+#include <iterator>
 #include <ranges>
 #include <memory_resource>
 #include <vector>
+#include <span>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <array>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+
+// The block geometry of a stable_vector. The first block holds
+// FirstBlockSize elements, and every block after that holds twice as many
+// as the one before it. FirstBlockSize must be a power of two, so that
+// the block of an index can be found without a division.
+template <std::size_t FirstBlockSize = 1>
+struct power_of_two_growth
+{
+    static_assert(std::has_single_bit(FirstBlockSize),
+                  "The size of the first block must be a power of two");
+
+    static constexpr std::size_t first_block_size = FirstBlockSize;
+    static constexpr std::size_t max_blocks
+        = std::numeric_limits<std::size_t>::digits
+        - static_cast<std::size_t>(std::countr_zero(FirstBlockSize));
+
+    [[nodiscard]]
+    static constexpr auto block_id(std::size_t idx) noexcept -> std::size_t;
+
+    [[nodiscard]]
+    static constexpr auto block_start(std::size_t block_id) noexcept -> std::size_t;
+
+    [[nodiscard]]
+    static constexpr auto block_size(std::size_t block_id) noexcept -> std::size_t;
+private:
+    static constexpr auto first_block_bits
+        = static_cast<std::size_t>(std::countr_zero(FirstBlockSize));
+};
+
+template <std::size_t FirstBlockSize>
+constexpr auto power_of_two_growth<FirstBlockSize>::block_id(std::size_t idx) noexcept
+-> std::size_t
+{
+    // FirstBlockSize == 1      FirstBlockSize == 2
+    //
+    //              14                    13
+    //              13                    12
+    //              12                    11
+    //              11                    10
+    //           6  10                 5   9
+    //           5   9                 4   8
+    //       2   4   8             1   3   7
+    //   0   1   3   7             0   2   6
+    return static_cast<std::size_t>(std::bit_width(idx + FirstBlockSize))
+        - 1 - first_block_bits;
+}
+
+template <std::size_t FirstBlockSize>
+constexpr auto power_of_two_growth<FirstBlockSize>::block_start(std::size_t block_id) noexcept
+-> std::size_t
+{
+    return (FirstBlockSize << block_id) - FirstBlockSize;
+}
+
+template <std::size_t FirstBlockSize>
+constexpr auto power_of_two_growth<FirstBlockSize>::block_size(std::size_t block_id) noexcept
+-> std::size_t
+{
+    return FirstBlockSize << block_id;
+}
+
+// A block geometry that doubles the block size from FirstBlockSize up to
+// MaxBlockSize, and then keeps allocating blocks of MaxBlockSize elements.
+// This bounds both the largest single allocation and the unused space in
+// the last block. Both sizes must be powers of two.
+template <std::size_t FirstBlockSize, std::size_t MaxBlockSize>
+struct capped_growth
+{
+    static_assert(std::has_single_bit(FirstBlockSize),
+                  "The size of the first block must be a power of two");
+    static_assert(std::has_single_bit(MaxBlockSize),
+                  "The maximum block size must be a power of two");
+    static_assert(FirstBlockSize <= MaxBlockSize,
+                  "The first block cannot be larger than the maximum block size");
+
+    static constexpr std::size_t first_block_size = FirstBlockSize;
+    static constexpr std::size_t max_block_size = MaxBlockSize;
+    // the number of blocks is only bounded by the size of the address space
+    static constexpr std::size_t max_blocks = std::numeric_limits<std::size_t>::max();
+
+    [[nodiscard]]
+    static constexpr auto block_id(std::size_t idx) noexcept -> std::size_t;
+
+    [[nodiscard]]
+    static constexpr auto block_start(std::size_t block_id) noexcept -> std::size_t;
+
+    [[nodiscard]]
+    static constexpr auto block_size(std::size_t block_id) noexcept -> std::size_t;
+private:
+    using doubling = power_of_two_growth<FirstBlockSize>;
+    static constexpr auto max_block_bits
+        = static_cast<std::size_t>(std::countr_zero(MaxBlockSize));
+    // the doubling blocks are those smaller than MaxBlockSize
+    static constexpr auto doubling_blocks = doubling::block_id(MaxBlockSize - FirstBlockSize);
+    static constexpr auto doubling_elements = MaxBlockSize - FirstBlockSize;
+};
+
+template <std::size_t FirstBlockSize, std::size_t MaxBlockSize>
+constexpr auto capped_growth<FirstBlockSize, MaxBlockSize>::block_id(std::size_t idx) noexcept
+-> std::size_t
+{
+    // FirstBlockSize == 1, MaxBlockSize == 4
+    //
+    //           6  10  14
+    //           5   9  13
+    //       2   4   8  12
+    //   0   1   3   7  11  ...
+    if (idx < doubling_elements)
+    {
+        return doubling::block_id(idx);
+    }
+    return doubling_blocks + ((idx - doubling_elements) >> max_block_bits);
+}
+
+template <std::size_t FirstBlockSize, std::size_t MaxBlockSize>
+constexpr auto capped_growth<FirstBlockSize, MaxBlockSize>::block_start(std::size_t block_id) noexcept
+-> std::size_t
+{
+    if (block_id < doubling_blocks)
+    {
+        return doubling::block_start(block_id);
+    }
+    return doubling_elements + ((block_id - doubling_blocks) << max_block_bits);
+}
+
+template <std::size_t FirstBlockSize, std::size_t MaxBlockSize>
+constexpr auto capped_growth<FirstBlockSize, MaxBlockSize>::block_size(std::size_t block_id) noexcept
+-> std::size_t
+{
+    if (block_id < doubling_blocks)
+    {
+        return doubling::block_size(block_id);
+    }
+    return MaxBlockSize;
+}
+
+namespace stable_vector_detail
+{
+// Gives the parallel algorithms and the I/O functions access to the
+// storage of a vector, to construct, destroy or read elements in place.
+struct storage_access;
+}
 
 template <
     typename T,
-    typename Alloc = std::allocator<T>
+    typename Alloc = std::allocator<T>,
+    typename Growth = power_of_two_growth<>
 >
 class stable_vector
 {
-    struct block;
-
     template <typename>
     class iterator_t;
+
+    template <typename>
+    struct block_span;
 public:
     using allocator_type = Alloc;
+    using growth_policy = Growth;
     using allocator_traits = std::allocator_traits<allocator_type>;
     using value_type = T;
     using reference = value_type&;
@@ -29,11 +184,18 @@ public:
     using const_iterator = iterator_t<const value_type>;
     using reverse_iterator = std::reverse_iterator<iterator>;
     using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using segment_range = std::ranges::transform_view<std::ranges::iota_view<std::size_t, std::size_t>,
+                                                      block_span<value_type>>;
+    using const_segment_range = std::ranges::transform_view<std::ranges::iota_view<std::size_t, std::size_t>,
+                                                            block_span<const value_type>>;
 
     stable_vector() = default;
 
     explicit stable_vector(allocator_type allocator);
 
+    // The blocks are taken over, so pointers and references to the elements
+    // stay valid. Iterators do not, since they point into the block table,
+    // which with doubling blocks is inside the vector object.
     stable_vector(stable_vector&& v) noexcept;
 
     stable_vector(stable_vector&& v, allocator_type alloc);
@@ -55,12 +217,23 @@ public:
 
     ~stable_vector();
 
+    // Assigns over the existing elements and constructs or destroys only
+    // the difference in size, keeping the blocks. If an element throws, the
+    // vector is valid but its elements unspecified. assign_strong() copies
+    // into new blocks first, and leaves the vector unchanged if one throws.
     auto operator=(const stable_vector& v) -> stable_vector&
     requires std::is_copy_constructible_v<T>;
 
-    auto operator=(stable_vector&& v) noexcept -> stable_vector&
+    void assign_strong(const stable_vector& v)
+    requires std::is_copy_constructible_v<T>;
+
+    // With allocators that compare unequal, the elements are moved one by
+    // one into the blocks of this vector, and v keeps its moved from
+    // elements.
+    auto operator=(stable_vector&& v)
+    noexcept(std::allocator_traits<Alloc>::is_always_equal::value) -> stable_vector&
     requires (std::allocator_traits<Alloc>::is_always_equal::value
-              || std::is_copy_constructible_v<T>);
+              || std::is_move_constructible_v<T>);
 
     auto push_back(const_reference t) -> reference
     requires std::is_copy_constructible_v<T>;
@@ -74,12 +247,42 @@ public:
 
     void pop_back() noexcept;
 
+    // Removes all elements from index n to the end, if there are any.
+    void truncate(std::size_t n) noexcept;
+
+    // Appends all elements of r. The number of elements is found first when
+    // possible, and then each block is filled in one go. If an element
+    // throws, the vector is left as it was.
+    template <std::ranges::input_range R>
+    void append_range(R&& r)
+    requires std::is_constructible_v<T, std::ranges::range_reference_t<R>>;
+
+    // Appends [i, e) and rotates the new elements into place before pos.
+    template <std::input_iterator Iterator, std::sentinel_for<Iterator> Sentinel>
+    auto insert(const_iterator pos, Iterator i, Sentinel e) -> iterator
+    requires (std::is_constructible_v<T, std::iter_reference_t<Iterator>>
+              && std::is_move_constructible_v<T>
+              && std::is_move_assignable_v<T>);
+
     [[nodiscard]]
     auto operator[](std::size_t idx) noexcept -> reference;
 
     [[nodiscard]]
     auto operator[](std::size_t idx) const noexcept -> const_reference;
 
+    // Writes the elements at indexes, in order, to out. Elements are
+    // prefetched a few indexes ahead, so that the cache misses of random
+    // lookups overlap. All indexes must be less than size().
+    template <std::weakly_incrementable O>
+    auto gather(std::span<const std::size_t> indexes, O out) const -> O
+    requires std::indirectly_copyable<const_pointer, O>;
+
+    // Assigns the values from in to the elements at indexes, in order, and
+    // returns the iterator after the last value used.
+    template <std::input_iterator I>
+    auto scatter(std::span<const std::size_t> indexes, I in) -> I
+    requires std::indirectly_copyable<I, pointer>;
+
     [[nodiscard]]
     auto front() noexcept -> reference;
 
@@ -98,8 +301,36 @@ public:
     [[nodiscard]]
     auto size() const noexcept -> std::size_t;
 
+    // Allocates all blocks needed to hold n elements, without constructing
+    // any. Reserved blocks are kept when elements are popped.
+    void reserve(std::size_t n);
+
+    [[nodiscard]]
+    auto capacity() const noexcept -> std::size_t;
+
+    // Releases all blocks after the last element, including reserved blocks
+    // and the spare block kept by pop_back().
+    void shrink_to_fit() noexcept;
+
     void clear() noexcept;
 
+    // Destroys all elements but keeps all blocks, as if reserved, so that
+    // refilling the vector does not allocate.
+    void clear_keep_capacity() noexcept;
+
+    // Constructs or destroys elements at the end, a block at a time, until
+    // there are n elements. New elements are value initialized, copies of
+    // value, or, with resize_for_overwrite(), default initialized, which
+    // leaves trivial types uninitialized.
+    void resize(std::size_t n)
+    requires std::is_default_constructible_v<T>;
+
+    void resize(std::size_t n, const_reference value)
+    requires std::is_copy_constructible_v<T>;
+
+    void resize_for_overwrite(std::size_t n)
+    requires std::is_default_constructible_v<T>;
+
     [[nodiscard]]
     auto begin() noexcept -> iterator;
 
@@ -129,6 +360,15 @@ public:
     [[nodiscard]]
     auto rend() const noexcept -> const_reverse_iterator;
 
+    // A random access range of std::span, one for each block in use,
+    // in the order of the elements. Inner loops over a span do not
+    // need the block boundary check that the iterators do.
+    [[nodiscard]]
+    auto segments() noexcept -> segment_range;
+
+    [[nodiscard]]
+    auto segments() const noexcept -> const_segment_range;
+
     auto erase(iterator pos) noexcept -> iterator
     requires std::is_nothrow_move_assignable_v<T>;
     auto erase(iterator ib, iterator ie) noexcept -> iterator
@@ -137,37 +377,160 @@ public:
     [[nodiscard]]
     auto get_allocator() const noexcept -> allocator_type;
 private:
+    // When the number of blocks is bounded by the width of an index, the
+    // block table is an array inside the vector, and is never reallocated.
+    static constexpr bool fixed_block_table
+        = Growth::max_blocks <= std::numeric_limits<std::size_t>::digits;
+
+    using pointer_allocator = typename allocator_traits::template rebind_alloc<pointer>;
+
+    // The first element of each allocated block, followed by at least one
+    // null pointer. The allocated blocks are always 0..n-1. Iterators point
+    // into the table, so when it is a std::vector, allocating a block may
+    // reallocate it and invalidate them.
+    using block_table = std::conditional_t<fixed_block_table,
+                                           std::array<pointer, Growth::max_blocks + 1>,
+                                           std::vector<pointer, pointer_allocator>>;
+
+    static auto make_block_table(const allocator_type& allocator) -> block_table;
+
     auto element_at(std::size_t idx) const noexcept -> reference;
+    template <bool Write, typename F>
+    void visit_prefetched(std::span<const std::size_t> indexes, F f) const;
+    template <typename TT>
+    auto iterator_at(std::size_t idx) const noexcept -> iterator_t<TT>;
+    auto used_blocks() const noexcept -> std::size_t;
+    auto block_at(std::size_t id) const noexcept -> pointer;
+    auto allocate_block(std::size_t id) -> pointer;
+    void deallocate_block(std::size_t id) noexcept;
+    void destroy_all() noexcept;
     void delete_all() noexcept;
-    template <typename Vector>
-    static
-    void delete_all(Vector& blocks, pointer end) noexcept;
+    void steal(stable_vector& v) noexcept;
 
     template <typename ... Ts>
     auto grow(Ts&& ... ts) -> reference;
 
+    template <typename Iterator, typename Sentinel>
+    void append(Iterator i, Sentinel e);
+    template <typename F>
+    void append_blocks(std::size_t n, F fill);
+    template <typename Vector>
+    void append_segments(Vector&& source, std::size_t first = 0);
+    template <typename Vector>
+    void assign_segments(Vector&& source);
+    template <typename Iterator>
+    auto construct_n(Iterator i, std::size_t n) -> Iterator;
+    template <typename ... Ts>
+    void construct_copies(std::size_t n, const Ts& ... ts);
+    // Destroy is false when the elements from n on are already destroyed.
+    template <bool Destroy = true>
+    void pop_to(std::size_t n) noexcept;
+
+    // Allocates the blocks needed for n elements, like reserve(), but they
+    // are released as the vector shrinks, like those push_back() allocates.
+    void allocate_blocks(std::size_t n);
+    // Releases the blocks after the last element that are neither reserved
+    // nor the spare, such as those left unfilled by a failed append.
+    void release_unused_blocks() noexcept;
+    void next_block();
     void shrink();
 
-    using block_allocator = typename allocator_traits::template rebind_alloc<block>;
-
     [[no_unique_address]] allocator_type allocator_;
     std::size_t size_ = 0;
+    // where the next element goes, and the end of the block it is in
     pointer end_ = nullptr;
-    std::vector<block, block_allocator> blocks_{allocator_};
+    pointer limit_ = nullptr;
+    std::size_t end_block_ = 0;
+    // blocks allocated by reserve(), which are kept when emptied
+    std::size_t reserved_blocks_ = 0;
+    block_table blocks_ = make_block_table(allocator_);
+
+    friend struct stable_vector_detail::storage_access;
+};
+
+namespace stable_vector_detail
+{
+struct storage_access
+{
+    // The storage of the elements first..last-1, one span per block. The
+    // storage from size() on is uninitialized, and must be allocated.
+    template <typename T, typename Alloc, typename Growth>
+    static auto storage(stable_vector<T, Alloc, Growth>& v, std::size_t first, std::size_t last)
+    -> std::vector<std::span<T>>
+    {
+        return spans<T>(v, first, last);
+    }
+
+    template <typename T, typename Alloc, typename Growth>
+    static auto storage(const stable_vector<T, Alloc, Growth>& v, std::size_t first, std::size_t last)
+    -> std::vector<std::span<const T>>
+    {
+        return spans<const T>(v, first, last);
+    }
+
+    // Allocates the blocks for n elements, without marking them reserved.
+    template <typename T, typename Alloc, typename Growth>
+    static void allocate(stable_vector<T, Alloc, Growth>& v, std::size_t n)
+    {
+        v.allocate_blocks(n);
+    }
+
+    // Releases the blocks left unfilled when constructing into the
+    // allocated storage fails.
+    template <typename T, typename Alloc, typename Growth>
+    static void release_unused(stable_vector<T, Alloc, Growth>& v) noexcept
+    {
+        v.release_unused_blocks();
+    }
+
+    // Makes the n elements constructed in the storage after the last
+    // element part of the vector. Their blocks must be allocated.
+    template <typename T, typename Alloc, typename Growth>
+    static void commit(stable_vector<T, Alloc, Growth>& v, std::size_t n) noexcept
+    {
+        v.append_blocks(n, [&v](std::size_t count) {
+            v.end_ += count;
+            v.size_ += count;
+        });
+    }
+
+    // Removes the elements from index n on, which are already destroyed.
+    template <typename T, typename Alloc, typename Growth>
+    static void forget(stable_vector<T, Alloc, Growth>& v, std::size_t n) noexcept
+    {
+        v.template pop_to<false>(n);
+    }
+private:
+    template <typename TT, typename T, typename Alloc, typename Growth>
+    static auto spans(const stable_vector<T, Alloc, Growth>& v, std::size_t first, std::size_t last)
+    -> std::vector<std::span<TT>>
+    {
+        std::vector<std::span<TT>> rv;
+        while (first != last)
+        {
+            const auto id = Growth::block_id(first);
+            const auto offset = first - Growth::block_start(id);
+            const auto count = std::min(last - first, Growth::block_size(id) - offset);
+            rv.emplace_back(v.blocks_[id] + offset, count);
+            first += count;
+        }
+        return rv;
+    }
 };
+}
 
 
-template <typename T, typename Alloc> template <typename TT>
-class stable_vector<T, Alloc>::iterator_t
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+class stable_vector<T, Alloc, Growth>::iterator_t
 {
-    friend class stable_vector<T, Alloc>;
-    using block = typename stable_vector<T, Alloc>::block;
+    friend class stable_vector<T, Alloc, Growth>;
+    using block_pointer = typename stable_vector<T, Alloc, Growth>::pointer;
 public:
     using value_type = T;
     using reference = TT&;
     using pointer = TT*;
     using difference_type = std::ptrdiff_t;
-    using iterator_category = std::bidirectional_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
 
     iterator_t() = default;
 
@@ -181,77 +544,123 @@ public:
     auto operator--() noexcept -> iterator_t&;
     auto operator--(int) noexcept -> iterator_t;
 
+    auto operator+=(difference_type n) noexcept -> iterator_t&;
+    auto operator-=(difference_type n) noexcept -> iterator_t&;
+
+    [[nodiscard]]
+    auto operator[](difference_type n) const noexcept -> reference;
+
     friend auto operator==(iterator_t lh, iterator_t rh) noexcept -> bool
     {
         return lh.current_element == rh.current_element;
     }
 
+    friend auto operator<=>(iterator_t lh, iterator_t rh) noexcept -> std::strong_ordering
+    {
+        // blocks are consecutive in the block table, so ordering by block
+        // first and element second gives the same order as the indexes
+        constexpr std::compare_three_way cmp;
+        if (const auto rv = cmp(lh.current_block, rh.current_block); rv != 0)
+        {
+            return rv;
+        }
+        return cmp(lh.current_element, rh.current_element);
+    }
+
+    friend auto operator+(iterator_t i, difference_type n) noexcept -> iterator_t
+    {
+        return i += n;
+    }
+
+    friend auto operator+(difference_type n, iterator_t i) noexcept -> iterator_t
+    {
+        return i += n;
+    }
+
+    friend auto operator-(iterator_t i, difference_type n) noexcept -> iterator_t
+    {
+        return i -= n;
+    }
+
+    friend auto operator-(iterator_t lh, iterator_t rh) noexcept -> difference_type
+    {
+        return static_cast<difference_type>(lh.index())
+            - static_cast<difference_type>(rh.index());
+    }
+
     operator iterator_t<const TT>() const noexcept;
 
 private:
-    iterator_t(pointer e, const block* b);
+    iterator_t(const block_pointer* blocks, std::size_t idx) noexcept;
+    iterator_t(pointer e, pointer be, const block_pointer* b, const block_pointer* first) noexcept;
 
-    template <typename> friend class iterator_t;
-    pointer current_element;
-    const block* current_block = nullptr;
+    auto index() const noexcept -> std::size_t;
+    void seek(std::size_t idx) noexcept;
+    void enter_block(const block_pointer* b) noexcept;
 
+    template <typename> friend class iterator_t;
+    pointer current_element = nullptr;
+    pointer block_end = nullptr;
+    const block_pointer* current_block = nullptr;
+    const block_pointer* first_block = nullptr;
 };
 
-template <typename T, typename Alloc>
-struct stable_vector<T, Alloc>::block
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+struct stable_vector<T, Alloc, Growth>::block_span
 {
-    pointer begin_;
-    pointer end_;
-    bool last_ = true;
+    const pointer* blocks_;
+    std::size_t size_;
+
+    auto operator()(std::size_t id) const noexcept -> std::span<TT>
+    {
+        const auto used = size_ - Growth::block_start(id);
+        return { blocks_[id], std::min(Growth::block_size(id), used) };
+    }
 };
 
-template <typename T, typename Alloc>
-stable_vector<T, Alloc>::stable_vector(allocator_type allocator)
+template <typename T, typename Alloc, typename Growth>
+stable_vector<T, Alloc, Growth>::stable_vector(allocator_type allocator)
     : allocator_(allocator)
 {
 }
 
-template <typename T, typename Alloc>
-stable_vector<T, Alloc>::stable_vector(stable_vector&& v) noexcept
+template <typename T, typename Alloc, typename Growth>
+stable_vector<T, Alloc, Growth>::stable_vector(stable_vector&& v) noexcept
     : allocator_(std::move(v.allocator_))
-    , size_(std::exchange(v.size_, 0))
-    , end_(std::exchange(v.end_, nullptr))
-    , blocks_(std::move(v.blocks_))
 {
+    steal(v);
 }
 
-template <typename T, typename Alloc>
-stable_vector<T, Alloc>::stable_vector(stable_vector&& v, allocator_type alloc)
+template <typename T, typename Alloc, typename Growth>
+stable_vector<T, Alloc, Growth>::stable_vector(stable_vector&& v, allocator_type alloc)
     : allocator_(std::move(alloc))
 {
     if constexpr (!std::allocator_traits<allocator_type>::is_always_equal::value)
     {
         if (allocator_ != v.get_allocator())
         {
-            blocks_.reserve(v.blocks_.size());
-            for (auto&& eleme : v)
+            try {
+                append_segments(std::move(v));
+            }
+            catch (...)
             {
-                push_back(std::move(eleme));
+                delete_all();
+                throw;
             }
             return;
         }
     }
-    size_ = std::exchange(v.size_, 0);
-    end_ = std::exchange(v.end_, nullptr);
-    blocks_= std::move(v.blocks_);
+    steal(v);
 }
 
-template <typename T, typename Alloc>
-stable_vector<T, Alloc>::stable_vector(const stable_vector& source)
+template <typename T, typename Alloc, typename Growth>
+stable_vector<T, Alloc, Growth>::stable_vector(const stable_vector& source)
 requires std::is_copy_constructible_v<T>
     : allocator_(std::allocator_traits<Alloc>::select_on_container_copy_construction(
     source.get_allocator()))
 {
-    blocks_.reserve(source.blocks_.size());
     try {
-        for (const auto &item: source) {
-            push_back(item);
-        }
+        append_segments(source);
     }
     catch (...)
     {
@@ -260,8 +669,8 @@ requires std::is_copy_constructible_v<T>
     }
 }
 
-template <typename T, typename Alloc>
-stable_vector<T, Alloc>::stable_vector(std::initializer_list<value_type> v,
+template <typename T, typename Alloc, typename Growth>
+stable_vector<T, Alloc, Growth>::stable_vector(std::initializer_list<value_type> v,
                                        allocator_type alloc)
 requires std::is_copy_constructible_v<T>
     : stable_vector(v.begin(), v.end(), alloc)
@@ -269,16 +678,13 @@ requires std::is_copy_constructible_v<T>
 }
 
 
-template <typename T, typename Alloc> template <std::input_iterator Iterator, std::sentinel_for<Iterator> Sentinel>
-stable_vector<T, Alloc>::stable_vector(Iterator i, Sentinel e, allocator_type alloc)
+template <typename T, typename Alloc, typename Growth> template <std::input_iterator Iterator, std::sentinel_for<Iterator> Sentinel>
+stable_vector<T, Alloc, Growth>::stable_vector(Iterator i, Sentinel e, allocator_type alloc)
 requires std::is_constructible_v<T, typename std::iterator_traits<Iterator>::value_type>
     : allocator_(alloc)
 {
     try {
-        while (i != e)
-        {
-            emplace_back(*i++);
-        }
+        append(std::move(i), std::move(e));
     }
     catch (...)
     {
@@ -288,94 +694,90 @@ requires std::is_constructible_v<T, typename std::iterator_traits<Iterator>::val
 
 }
 
-template <typename T, typename Alloc> template <std::ranges::range R>
-stable_vector<T, Alloc>::stable_vector(const R& r, allocator_type alloc)
+template <typename T, typename Alloc, typename Growth> template <std::ranges::range R>
+stable_vector<T, Alloc, Growth>::stable_vector(const R& r, allocator_type alloc)
 requires std::is_constructible_v<T, std::ranges::range_reference_t<R>>
     : stable_vector(std::begin(r), std::end(r), alloc)
 {
 }
 
-template <typename T, typename Alloc>
-stable_vector<T, Alloc>::~stable_vector()
+template <typename T, typename Alloc, typename Growth>
+stable_vector<T, Alloc, Growth>::~stable_vector()
 {
     delete_all();
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::operator=(const stable_vector& v) -> stable_vector&
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::operator=(const stable_vector& v) -> stable_vector&
 requires std::is_copy_constructible_v<T>
 {
     if (&v != this)
     {
-        auto old_blocks = std::move(blocks_);
-        auto old_end = std::exchange(end_, nullptr);
-        auto old_size = std::exchange(size_, 0);
-        blocks_.clear();
-        try {
-            blocks_.reserve(v.blocks_.size());
-            end_ = nullptr;
-            for (const auto& e : v)
-            {
-                push_back(e);
-            }
-        }
-        catch (...)
-        {
-            delete_all(blocks_, end_);
-            size_ = old_size;
-            end_ = old_end;
-            std::swap(blocks_, old_blocks);
-            throw ;
-        }
-        delete_all(old_blocks, old_end);
+        assign_segments(v);
     }
     return *this;
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::operator=(stable_vector&& v) noexcept -> stable_vector&
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::assign_strong(const stable_vector& v)
+requires std::is_copy_constructible_v<T>
+{
+    if (&v != this)
+    {
+        stable_vector copy(allocator_);
+        copy.append_segments(v);
+        delete_all();
+        steal(copy);
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::operator=(stable_vector&& v)
+noexcept(std::allocator_traits<Alloc>::is_always_equal::value) -> stable_vector&
 requires (std::allocator_traits<Alloc>::is_always_equal::value
-          || std::is_copy_constructible_v<T>)
+          || std::is_move_constructible_v<T>)
 {
     if constexpr (!typename std::allocator_traits<allocator_type>::is_always_equal{})
     {
         if (get_allocator() != v.get_allocator())
         {
-            return operator=(v); // copy;
+            // the blocks cannot change owner, so move the elements
+            assign_segments(std::move(v));
+            return *this;
         }
     }
-    delete_all();
-    size_ = std::exchange(v.size_, 0);
-    end_ = std::exchange(v.end_, nullptr);
-    std::swap(blocks_, v.blocks_);
-    v.blocks_.clear();
+    if (&v != this)
+    {
+        delete_all();
+        steal(v);
+    }
     return *this;
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::push_back(const_reference t) -> reference
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::push_back(const_reference t) -> reference
 requires std::is_copy_constructible_v<T>
 {
     return grow(t);
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::push_back(value_type&& t) -> reference
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::push_back(value_type&& t) -> reference
 requires std::is_move_constructible_v<T>
 {
     return grow(std::move(t));
 }
 
 
-template <typename T, typename Alloc> template <typename ... Ts>
-auto stable_vector<T, Alloc>::emplace_back(Ts&& ... ts) -> reference
+template <typename T, typename Alloc, typename Growth> template <typename ... Ts>
+auto stable_vector<T, Alloc, Growth>::emplace_back(Ts&& ... ts) -> reference
 requires std::is_constructible_v<T, Ts...>
 {
     return grow(std::forward<Ts>(ts)...);
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::pop_back() noexcept -> void
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::pop_back() noexcept -> void
 {
     --size_;
     --end_;
@@ -383,147 +785,265 @@ auto stable_vector<T, Alloc>::pop_back() noexcept -> void
     shrink();
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::operator[](std::size_t idx) noexcept -> reference
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::truncate(std::size_t n) noexcept
+{
+    if (n < size_)
+    {
+        pop_to(n);
+    }
+}
+
+template <typename T, typename Alloc, typename Growth> template <std::ranges::input_range R>
+void stable_vector<T, Alloc, Growth>::append_range(R&& r)
+requires std::is_constructible_v<T, std::ranges::range_reference_t<R>>
+{
+    append(std::ranges::begin(r), std::ranges::end(r));
+}
+
+template <typename T, typename Alloc, typename Growth>
+template <std::input_iterator Iterator, std::sentinel_for<Iterator> Sentinel>
+auto stable_vector<T, Alloc, Growth>::insert(const_iterator pos, Iterator i, Sentinel e) -> iterator
+requires (std::is_constructible_v<T, std::iter_reference_t<Iterator>>
+          && std::is_move_constructible_v<T>
+          && std::is_move_assignable_v<T>)
+{
+    const auto idx = pos - cbegin();
+    const auto old_size = static_cast<std::ptrdiff_t>(size_);
+    append(std::move(i), std::move(e));
+    const auto first = begin() + idx;
+    if (idx != old_size)
+    {
+        std::rotate(first, begin() + old_size, end());
+    }
+    return first;
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::operator[](std::size_t idx) noexcept -> reference
 {
     return element_at(idx);
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::operator[](std::size_t idx) const noexcept -> const_reference
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::operator[](std::size_t idx) const noexcept -> const_reference
 {
     return element_at(idx);
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::front() noexcept -> reference
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::front() noexcept -> reference
 {
-    return *blocks_.front().begin_;
+    return *blocks_[0];
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::front() const noexcept -> const_reference
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::front() const noexcept -> const_reference
 {
-    return *blocks_.front().begin_;
+    return *blocks_[0];
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::back() noexcept -> reference
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::back() noexcept -> reference
 {
     return *std::prev(end_);
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::back() const noexcept -> const_reference
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::back() const noexcept -> const_reference
 {
     return *std::prev(end_);
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::empty() const noexcept -> bool
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::empty() const noexcept -> bool
 {
     return size_ == 0;
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::size() const noexcept -> std::size_t
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::size() const noexcept -> std::size_t
 {
     return size_;
 }
 
-template <typename T, typename Alloc>
-void stable_vector<T, Alloc>::clear() noexcept
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::reserve(std::size_t n)
 {
-    delete_all();
-    end_ = nullptr;
-    size_ = 0;
+    if (n == 0)
+    {
+        return;
+    }
+    allocate_blocks(n);
+    reserved_blocks_ = std::max(reserved_blocks_, Growth::block_id(n - 1) + 1);
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::begin() noexcept -> iterator
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::capacity() const noexcept -> std::size_t
 {
-    if (empty()) {
-        return {nullptr, nullptr};
+    std::size_t blocks = used_blocks();
+    while (block_at(blocks) != nullptr)
+    {
+        ++blocks;
     }
-    auto& b = blocks_.front();
-    return { b.begin_, &b };
+    return Growth::block_start(blocks);
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::begin() const noexcept -> const_iterator
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::shrink_to_fit() noexcept
 {
-    if (empty()) {
-        return {nullptr, nullptr};
+    auto id = end_ == nullptr ? 0 : end_block_ + 1;
+    reserved_blocks_ = std::min(reserved_blocks_, id);
+    while (block_at(id) != nullptr)
+    {
+        deallocate_block(id);
+        ++id;
     }
-    auto& b = blocks_.front();
-    return { b.begin_, &b };
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::cbegin() const noexcept -> const_iterator
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::resize(std::size_t n)
+requires std::is_default_constructible_v<T>
 {
-    if (empty()) {
-        return {nullptr, nullptr};
+    if (n <= size_)
+    {
+        pop_to(n);
+        return;
     }
-    auto& b = blocks_.front();
-    return { b.begin_, &b };
+    append_blocks(n - size_, [this](std::size_t count) { construct_copies(count); });
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::end() noexcept -> iterator
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::resize(std::size_t n, const_reference value)
+requires std::is_copy_constructible_v<T>
 {
-    if (empty()) {
-        return {nullptr, nullptr};
+    if (n <= size_)
+    {
+        pop_to(n);
+        return;
     }
-    auto& b = blocks_.back(); return { end_, &b };
+    append_blocks(n - size_, [&](std::size_t count) { construct_copies(count, value); });
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::end() const noexcept -> const_iterator
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::resize_for_overwrite(std::size_t n)
+requires std::is_default_constructible_v<T>
 {
-    if (empty()) {
-        return {nullptr, nullptr};
+    if constexpr (std::uses_allocator_v<value_type, allocator_type>)
+    {
+        resize(n);
+    }
+    else
+    {
+        if (n <= size_)
+        {
+            pop_to(n);
+            return;
+        }
+        append_blocks(n - size_, [this](std::size_t count) {
+            std::uninitialized_default_construct_n(end_, count);
+            end_ += count;
+            size_ += count;
+        });
     }
-    auto& b = blocks_.back();
-    return { end_, &b };
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::cend() const noexcept -> const_iterator
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::clear() noexcept
+{
+    delete_all();
+}
+
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::clear_keep_capacity() noexcept
 {
-    if (empty()) {
-        return {nullptr, nullptr};
+    destroy_all();
+    while (block_at(reserved_blocks_) != nullptr)
+    {
+        ++reserved_blocks_;
     }
-    auto& b = blocks_.back();
-    return { end_, &b };
+    size_ = 0;
+    end_ = nullptr;
+    limit_ = nullptr;
+    end_block_ = 0;
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::begin() noexcept -> iterator
+{
+    return iterator_at<value_type>(0);
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::begin() const noexcept -> const_iterator
+{
+    return iterator_at<const value_type>(0);
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::cbegin() const noexcept -> const_iterator
+{
+    return iterator_at<const value_type>(0);
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::end() noexcept -> iterator
+{
+    return iterator_at<value_type>(size_);
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::end() const noexcept -> const_iterator
+{
+    return iterator_at<const value_type>(size_);
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::cend() const noexcept -> const_iterator
+{
+    return iterator_at<const value_type>(size_);
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::rbegin() noexcept -> reverse_iterator
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::rbegin() noexcept -> reverse_iterator
 {
     return std::reverse_iterator(end());
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::rbegin() const noexcept -> const_reverse_iterator
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::rbegin() const noexcept -> const_reverse_iterator
 {
     return std::reverse_iterator(end());
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::rend() noexcept -> reverse_iterator
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::rend() noexcept -> reverse_iterator
 {
     return std::reverse_iterator(begin());
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::rend() const noexcept -> const_reverse_iterator
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::rend() const noexcept -> const_reverse_iterator
 {
     return std::reverse_iterator(begin());
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::erase(iterator pos) noexcept -> iterator
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::segments() noexcept -> segment_range
+{
+    return segment_range(std::views::iota(std::size_t{}, used_blocks()),
+                         block_span<value_type>{blocks_.data(), size_});
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::segments() const noexcept -> const_segment_range
+{
+    return const_segment_range(std::views::iota(std::size_t{}, used_blocks()),
+                               block_span<const value_type>{blocks_.data(), size_});
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::erase(iterator pos) noexcept -> iterator
 requires std::is_nothrow_move_assignable_v<T>
 {
     auto e = end();
@@ -540,202 +1060,835 @@ requires std::is_nothrow_move_assignable_v<T>
     return pos;
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::erase(iterator ib, iterator ie) noexcept -> iterator
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::erase(iterator ib, iterator ie) noexcept -> iterator
 requires std::is_nothrow_move_assignable_v<T>
 {
+    if (ib == ie)
+    {
+        return ie;
+    }
     const auto e = end();
-    auto rv = ie;
+    const auto first = ib - begin();
     while (ie != e)
     {
         *ib = std::move(*ie);
         ++ie; ++ib;
     }
-    bool at_end = false;
-    while (!empty() && end_ != ib.operator->())
-    {
-        at_end = at_end | (rv == end());
-        pop_back();
-    }
-
-    if (at_end)
-    {
-        rv = end();
-    }
-    return rv;
+    pop_to(static_cast<std::size_t>(ib - begin()));
+    // the element that followed the erased range is now where it began
+    return begin() + first;
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::get_allocator() const noexcept -> allocator_type
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::get_allocator() const noexcept -> allocator_type
 {
     return allocator_;
 }
 
-template <typename T, typename Alloc>
-auto stable_vector<T, Alloc>::element_at(std::size_t idx) const noexcept -> reference
-{
-    //              14
-    //              13
-    //              12
-    //              11
-    //           6  10
-    //           5   9
-    //       2   4   8
-    //   0   1   3   7
-    const auto block_id = static_cast<std::size_t>(std::bit_width(idx + 1)) - 1;
-    const auto block_offset = idx - (1ULL << block_id) + 1;
-    return blocks_[block_id].begin_[block_offset];
-}
-
-template <typename T, typename Alloc>
-void stable_vector<T, Alloc>::delete_all() noexcept
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::element_at(std::size_t idx) const noexcept -> reference
 {
-    delete_all(blocks_, end_);
+    const auto id = Growth::block_id(idx);
+    const auto block_offset = idx - Growth::block_start(id);
+    return blocks_[id][block_offset];
 }
 
-template <typename T, typename Alloc> template <typename Vector>
-void stable_vector<T, Alloc>::delete_all(Vector& blocks, pointer end) noexcept
+// Calls f with a pointer to the element at each index, in order. The
+// element for an index some steps ahead is prefetched before the current
+// one is visited, so that the cache misses of random indexes overlap.
+template <typename T, typename Alloc, typename Growth> template <bool Write, typename F>
+void stable_vector<T, Alloc, Growth>::visit_prefetched(std::span<const std::size_t> indexes, F f) const
 {
-    allocator_type allocator = blocks.get_allocator();
-    while (!blocks.empty())
-    {
-        auto& last_block = blocks.back();
-        if (!last_block.last_)
+    constexpr std::size_t distance = 16;
+    const auto visit = [&](auto address) {
+        pointer ahead[distance];
+        const auto n = indexes.size();
+        for (std::size_t i = 0; i != std::min(n, distance); ++i)
         {
-            end = last_block.end_;
+            ahead[i] = address(indexes[i]);
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(ahead[i], Write);
+#endif
         }
-        if constexpr (!std::is_trivially_destructible_v<value_type>) {
-            while (end != last_block.begin_)
+        for (std::size_t i = 0; i != n; ++i)
+        {
+            const auto p = ahead[i % distance];
+            if (i + distance < n)
             {
-                --end;
-                std::destroy_at(end);
+                ahead[i % distance] = address(indexes[i + distance]);
+#if defined(__GNUC__) || defined(__clang__)
+                __builtin_prefetch(ahead[i % distance], Write);
+#endif
             }
+            f(p);
         }
-        const auto idx = blocks.size() - 1;
-        allocator.deallocate(last_block.begin_, 1ULL << idx);
-        blocks.pop_back();
-    }
-}
-
-template <typename T, typename Alloc> template <typename ... Ts>
-auto stable_vector<T, Alloc>::grow(Ts&& ... ts) -> reference
-{
-    if (empty() || end_ == blocks_.back().end_)
+    };
+    if constexpr (fixed_block_table)
     {
-        const std::size_t size = 1ULL << blocks_.size();
-        end_ = allocator_.allocate(size);
-        blocks_.push_back({end_, end_ + size});
-        if (blocks_.size() > 1) {
-            blocks_[blocks_.size() - 2].last_ = false;
+        // The address of each block, less the offset of its first element,
+        // so that the address of an element is found from its index with
+        // one lookup and one addition, and no shift by the block id.
+        std::array<std::uintptr_t, Growth::max_blocks> biased;
+        for (std::size_t id = 0; id != used_blocks(); ++id)
+        {
+            biased[id] = reinterpret_cast<std::uintptr_t>(blocks_[id])
+                - Growth::block_start(id) * sizeof(value_type);
         }
+        visit([&biased](std::size_t idx) {
+            return reinterpret_cast<pointer>(biased[Growth::block_id(idx)] + idx * sizeof(value_type));
+        });
     }
-    try {
-        std::uninitialized_construct_using_allocator<value_type>(end_,
-                                                                 allocator_,
-                                                                 std::forward<Ts>(ts)...);
-    }
-    catch (...)
+    else
     {
-        shrink();
-        throw;
+        visit([this](std::size_t idx) { return &element_at(idx); });
     }
-    ++size_;
-    return *end_++;
 }
 
-template <typename T, typename Alloc>
-void stable_vector<T, Alloc>::shrink()
+template <typename T, typename Alloc, typename Growth> template <std::weakly_incrementable O>
+auto stable_vector<T, Alloc, Growth>::gather(std::span<const std::size_t> indexes, O out) const -> O
+requires std::indirectly_copyable<const_pointer, O>
 {
-    if (end_ == blocks_.back().begin_)
-    {
-        blocks_.pop_back();
-        allocator_.deallocate(end_, 1ULL << blocks_.size());
-        if (blocks_.empty())
-        {
-            end_ = nullptr;
+    visit_prefetched<false>(indexes, [&out](const_pointer p) {
+        *out = *p;
+        ++out;
+    });
+    return out;
+}
+
+template <typename T, typename Alloc, typename Growth> template <std::input_iterator I>
+auto stable_vector<T, Alloc, Growth>::scatter(std::span<const std::size_t> indexes, I in) -> I
+requires std::indirectly_copyable<I, pointer>
+{
+    visit_prefetched<true>(indexes, [&in](pointer p) {
+        *p = *in;
+        ++in;
+    });
+    return in;
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+auto stable_vector<T, Alloc, Growth>::iterator_at(std::size_t idx) const noexcept -> iterator_t<TT>
+{
+    if (block_at(0) == nullptr)
+    {
+        return {};
+    }
+    return { blocks_.data(), idx };
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::used_blocks() const noexcept -> std::size_t
+{
+    return size_ == 0 ? 0 : Growth::block_id(size_ - 1) + 1;
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::make_block_table(const allocator_type& allocator)
+-> block_table
+{
+    if constexpr (fixed_block_table)
+    {
+        return {};
+    }
+    else
+    {
+        return block_table(pointer_allocator(allocator));
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::block_at(std::size_t id) const noexcept -> pointer
+{
+    if constexpr (fixed_block_table)
+    {
+        return blocks_[id];
+    }
+    else
+    {
+        return id < blocks_.size() ? blocks_[id] : nullptr;
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto stable_vector<T, Alloc, Growth>::allocate_block(std::size_t id) -> pointer
+{
+    if constexpr (!fixed_block_table)
+    {
+        if (blocks_.size() < id + 2)
+        {
+            blocks_.resize(id + 2);
+        }
+    }
+    blocks_[id] = allocator_.allocate(Growth::block_size(id));
+    return blocks_[id];
+}
+
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::deallocate_block(std::size_t id) noexcept
+{
+    allocator_.deallocate(std::exchange(blocks_[id], nullptr), Growth::block_size(id));
+}
+
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::destroy_all() noexcept
+{
+    if constexpr (!std::is_trivially_destructible_v<value_type>)
+    {
+        for (auto segment : segments() | std::views::reverse)
+        {
+            std::destroy(segment.rbegin(), segment.rend());
+        }
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::delete_all() noexcept
+{
+    destroy_all();
+    for (std::size_t id = 0; block_at(id) != nullptr; ++id)
+    {
+        deallocate_block(id);
+    }
+    size_ = 0;
+    end_ = nullptr;
+    limit_ = nullptr;
+    end_block_ = 0;
+    reserved_blocks_ = 0;
+}
+
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::steal(stable_vector& v) noexcept
+{
+    size_ = std::exchange(v.size_, 0);
+    end_ = std::exchange(v.end_, nullptr);
+    limit_ = std::exchange(v.limit_, nullptr);
+    end_block_ = std::exchange(v.end_block_, 0);
+    reserved_blocks_ = std::exchange(v.reserved_blocks_, 0);
+    if constexpr (fixed_block_table)
+    {
+        blocks_ = std::exchange(v.blocks_, {});
+    }
+    else
+    {
+        blocks_ = std::move(v.blocks_);
+        v.blocks_.clear();
+    }
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename ... Ts>
+auto stable_vector<T, Alloc, Growth>::grow(Ts&& ... ts) -> reference
+{
+    if (end_ == limit_)
+    {
+        next_block();
+    }
+    try {
+        std::uninitialized_construct_using_allocator<value_type>(end_,
+                                                                 allocator_,
+                                                                 std::forward<Ts>(ts)...);
+    }
+    catch (...)
+    {
+        shrink();
+        throw;
+    }
+    ++size_;
+    return *end_++;
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename Iterator, typename Sentinel>
+void stable_vector<T, Alloc, Growth>::append(Iterator i, Sentinel e)
+{
+    const auto old_size = size_;
+    try {
+        if constexpr (std::sized_sentinel_for<Sentinel, Iterator> || std::forward_iterator<Iterator>)
+        {
+            const auto n = static_cast<std::size_t>(std::ranges::distance(i, e));
+            allocate_blocks(size_ + n);
+            append_blocks(n, [&](std::size_t count) { i = construct_n(std::move(i), count); });
         }
         else
         {
-            blocks_.back().last_ = true;
-            end_ = blocks_.back().end_;
+            for (; i != e; ++i)
+            {
+                emplace_back(*i);
+            }
+        }
+    }
+    catch (...)
+    {
+        pop_to(old_size);
+        release_unused_blocks();
+        throw;
+    }
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename F>
+void stable_vector<T, Alloc, Growth>::append_blocks(std::size_t n, F fill)
+{
+    const auto old_size = size_;
+    try {
+        while (n != 0)
+        {
+            if (end_ == limit_)
+            {
+                next_block();
+            }
+            const auto count = std::min(n, static_cast<std::size_t>(limit_ - end_));
+            fill(count);
+            n -= count;
         }
     }
+    catch (...)
+    {
+        shrink();
+        pop_to(old_size);
+        throw;
+    }
+}
 
+// Copies, or moves from an rvalue, the elements of source from index first,
+// one block at a time. When the size of this vector is first, the blocks
+// of both line up, so each block is a single memcpy for trivially copyable
+// types.
+template <typename T, typename Alloc, typename Growth> template <typename Vector>
+void stable_vector<T, Alloc, Growth>::append_segments(Vector&& source, std::size_t first)
+{
+    constexpr bool move = !std::is_lvalue_reference_v<Vector>
+        && !std::is_trivially_copyable_v<value_type>;
+    const auto old_size = size_;
+    try {
+        allocate_blocks(size_ + source.size() - first);
+        std::size_t start = 0;
+        for (auto segment : source.segments())
+        {
+            const auto skip = std::min(segment.size(), first - std::min(first, start));
+            const auto b = segment.begin() + static_cast<std::ptrdiff_t>(skip);
+            if constexpr (move)
+            {
+                auto i = std::make_move_iterator(b);
+                append_blocks(segment.size() - skip, [&](std::size_t count) { i = construct_n(i, count); });
+            }
+            else
+            {
+                auto i = b;
+                append_blocks(segment.size() - skip, [&](std::size_t count) { i = construct_n(i, count); });
+            }
+            start += segment.size();
+        }
+    }
+    catch (...)
+    {
+        pop_to(old_size);
+        release_unused_blocks();
+        throw;
+    }
 }
 
-template <typename T, typename Alloc> template <typename TT>
-auto stable_vector<T, Alloc>::iterator_t<TT>::operator++() noexcept -> iterator_t&
+// Copy or move assigns the elements of source over the elements of this
+// vector, and then constructs or destroys the difference in size.
+template <typename T, typename Alloc, typename Growth> template <typename Vector>
+void stable_vector<T, Alloc, Growth>::assign_segments(Vector&& source)
+{
+    constexpr bool move = !std::is_lvalue_reference_v<Vector>;
+    constexpr bool assignable = move ? std::is_move_assignable_v<value_type>
+                                     : std::is_copy_assignable_v<value_type>;
+    if constexpr (assignable)
+    {
+        // the blocks have the same sizes, so the common elements can be
+        // assigned block by block
+        const auto common = std::min(size_, source.size_);
+        for (std::size_t id = 0; common > Growth::block_start(id); ++id)
+        {
+            const auto count = std::min(Growth::block_size(id), common - Growth::block_start(id));
+            const auto from = source.blocks_[id];
+            if constexpr (move)
+            {
+                std::move(from, from + count, blocks_[id]);
+            }
+            else
+            {
+                std::copy_n(from, count, blocks_[id]);
+            }
+        }
+        if (source.size_ <= size_)
+        {
+            pop_to(source.size_);
+        }
+        else
+        {
+            append_segments(std::forward<Vector>(source), common);
+        }
+    }
+    else
+    {
+        pop_to(0);
+        append_segments(std::forward<Vector>(source));
+    }
+}
+
+// Destroys the elements from index n a block at a time, and releases the
+// emptied blocks the same way pop_back() does.
+template <typename T, typename Alloc, typename Growth> template <bool Destroy>
+void stable_vector<T, Alloc, Growth>::pop_to(std::size_t n) noexcept
+{
+    while (size_ != n)
+    {
+        const auto count = std::min(size_ - n,
+                                    static_cast<std::size_t>(end_ - blocks_[end_block_]));
+        if constexpr (Destroy && !std::is_trivially_destructible_v<value_type>)
+        {
+            std::destroy(std::make_reverse_iterator(end_), std::make_reverse_iterator(end_ - count));
+        }
+        end_ -= count;
+        size_ -= count;
+        shrink();
+    }
+}
+
+// Constructs n elements from i at end_, which must all fit in the current
+// block, and returns the iterator after the last one used.
+template <typename T, typename Alloc, typename Growth> template <typename Iterator>
+auto stable_vector<T, Alloc, Growth>::construct_n(Iterator i, std::size_t n) -> Iterator
+{
+    using source_type = std::remove_cvref_t<std::iter_reference_t<Iterator>>;
+    if constexpr (std::contiguous_iterator<Iterator>
+                  && std::is_same_v<source_type, value_type>
+                  && std::is_trivially_copyable_v<value_type>
+                  && !std::uses_allocator_v<value_type, allocator_type>)
+    {
+        std::memcpy(end_, std::to_address(i), n * sizeof(value_type));
+        i += static_cast<std::iter_difference_t<Iterator>>(n);
+    }
+    else
+    {
+        auto p = end_;
+        try {
+            for (; p != end_ + n; ++p, ++i)
+            {
+                std::uninitialized_construct_using_allocator<value_type>(p, allocator_, *i);
+            }
+        }
+        catch (...)
+        {
+            std::destroy(end_, p);
+            throw;
+        }
+    }
+    end_ += n;
+    size_ += n;
+    return i;
+}
+
+// Constructs n elements at end_ from ts, or value initialized if there are
+// none. They must all fit in the current block.
+template <typename T, typename Alloc, typename Growth> template <typename ... Ts>
+void stable_vector<T, Alloc, Growth>::construct_copies(std::size_t n, const Ts& ... ts)
+{
+    if constexpr (!std::uses_allocator_v<value_type, allocator_type> && sizeof...(Ts) == 0)
+    {
+        std::uninitialized_value_construct_n(end_, n);
+    }
+    else if constexpr (!std::uses_allocator_v<value_type, allocator_type>)
+    {
+        std::uninitialized_fill_n(end_, n, ts...);
+    }
+    else
+    {
+        auto p = end_;
+        try {
+            for (; p != end_ + n; ++p)
+            {
+                std::uninitialized_construct_using_allocator<value_type>(p, allocator_, ts...);
+            }
+        }
+        catch (...)
+        {
+            std::destroy(end_, p);
+            throw;
+        }
+    }
+    end_ += n;
+    size_ += n;
+}
+
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::allocate_blocks(std::size_t n)
+{
+    if (n == 0)
+    {
+        return;
+    }
+    // the blocks in use are all allocated
+    const auto blocks = Growth::block_id(n - 1) + 1;
+    for (auto id = used_blocks(); id < blocks; ++id)
+    {
+        if (block_at(id) == nullptr)
+        {
+            allocate_block(id);
+        }
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::release_unused_blocks() noexcept
+{
+    const auto spare = end_ == nullptr ? 0 : end_block_ + 1;
+    for (auto id = std::max(reserved_blocks_, spare + 1); block_at(id) != nullptr; ++id)
+    {
+        deallocate_block(id);
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::next_block()
+{
+    const auto id = end_ == nullptr ? 0 : end_block_ + 1;
+    auto b = block_at(id);
+    if (b == nullptr)
+    {
+        b = allocate_block(id);
+    }
+    end_block_ = id;
+    end_ = b;
+    limit_ = b + Growth::block_size(id);
+}
+
+template <typename T, typename Alloc, typename Growth>
+void stable_vector<T, Alloc, Growth>::shrink()
+{
+    if (end_ == blocks_[end_block_])
+    {
+        // The emptied block is kept as a spare, so that a vector that goes
+        // back and forth over a block boundary does not allocate and free
+        // the block every time. Only the spare from an earlier crossing is
+        // released.
+        if (end_block_ + 1 >= reserved_blocks_ && block_at(end_block_ + 1) != nullptr)
+        {
+            deallocate_block(end_block_ + 1);
+        }
+        if (end_block_ == 0)
+        {
+            end_ = nullptr;
+            limit_ = nullptr;
+        }
+        else
+        {
+            --end_block_;
+            limit_ = blocks_[end_block_] + Growth::block_size(end_block_);
+            end_ = limit_;
+        }
+    }
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+auto stable_vector<T, Alloc, Growth>::iterator_t<TT>::operator++() noexcept -> iterator_t&
 {
     ++current_element;
-    if (current_element == current_block->end_ && !current_block->last_)
+    if (current_element == block_end && current_block[1] != nullptr)
     {
-        ++current_block;
-        current_element = current_block->begin_;
+        enter_block(current_block + 1);
     }
     return *this;
 }
 
-template <typename T, typename Alloc> template <typename TT>
-auto stable_vector<T, Alloc>::iterator_t<TT>::operator++(int) noexcept -> iterator_t
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+auto stable_vector<T, Alloc, Growth>::iterator_t<TT>::operator++(int) noexcept -> iterator_t
 {
     auto copy = *this;
     ++*this;
     return copy;
 }
 
-template <typename T, typename Alloc> template <typename TT>
-auto stable_vector<T, Alloc>::iterator_t<TT>::operator--() noexcept -> iterator_t&
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+auto stable_vector<T, Alloc, Growth>::iterator_t<TT>::operator--() noexcept -> iterator_t&
 {
-    if (current_element == current_block->begin_)
+    if (current_element == *current_block)
     {
-        --current_block;
-        current_element = current_block->end_;
+        enter_block(current_block - 1);
+        current_element = block_end;
     }
     --current_element;
     return *this;
 }
 
-template <typename T, typename Alloc> template <typename TT>
-auto stable_vector<T, Alloc>::iterator_t<TT>::operator--(int) noexcept -> iterator_t
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+auto stable_vector<T, Alloc, Growth>::iterator_t<TT>::operator--(int) noexcept -> iterator_t
 {
     auto copy = *this;
     --*this;
     return copy;
 }
 
-template <typename T, typename Alloc> template <typename TT>
-stable_vector<T, Alloc>::iterator_t<TT>::operator iterator_t<const TT>() const noexcept
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+auto stable_vector<T, Alloc, Growth>::iterator_t<TT>::operator+=(difference_type n) noexcept -> iterator_t&
 {
-    return { current_element, current_block };
+    seek(static_cast<std::size_t>(static_cast<difference_type>(index()) + n));
+    return *this;
 }
 
-template <typename T, typename Alloc> template <typename TT>
-auto stable_vector<T, Alloc>::iterator_t<TT>::operator*() const noexcept -> reference
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+auto stable_vector<T, Alloc, Growth>::iterator_t<TT>::operator-=(difference_type n) noexcept -> iterator_t&
+{
+    return *this += -n;
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+auto stable_vector<T, Alloc, Growth>::iterator_t<TT>::operator[](difference_type n) const noexcept -> reference
+{
+    return *(*this + n);
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+stable_vector<T, Alloc, Growth>::iterator_t<TT>::operator iterator_t<const TT>() const noexcept
+{
+    return { current_element, block_end, current_block, first_block };
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+auto stable_vector<T, Alloc, Growth>::iterator_t<TT>::operator*() const noexcept -> reference
 {
     return *current_element;
 }
 
-template <typename T, typename Alloc> template <typename TT>
-auto stable_vector<T, Alloc>::iterator_t<TT>::operator->() const noexcept -> pointer
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+auto stable_vector<T, Alloc, Growth>::iterator_t<TT>::operator->() const noexcept -> pointer
 {
     return current_element;
 }
 
-template <typename T, typename Alloc> template <typename TT>
-stable_vector<T, Alloc>::iterator_t<TT>::iterator_t(pointer e, const block* b)
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+stable_vector<T, Alloc, Growth>::iterator_t<TT>::iterator_t(const block_pointer* blocks,
+                                                            std::size_t idx) noexcept
+    : first_block(blocks)
+{
+    seek(idx);
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+stable_vector<T, Alloc, Growth>::iterator_t<TT>::iterator_t(pointer e,
+                                                            pointer be,
+                                                            const block_pointer* b,
+                                                            const block_pointer* first) noexcept
     : current_element(e)
+    , block_end(be)
     , current_block(b)
+    , first_block(first)
+{
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+auto stable_vector<T, Alloc, Growth>::iterator_t<TT>::index() const noexcept -> std::size_t
+{
+    if (current_block == nullptr)
+    {
+        return 0;
+    }
+    const auto id = static_cast<std::size_t>(current_block - first_block);
+    return Growth::block_start(id)
+        + static_cast<std::size_t>(current_element - *current_block);
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+void stable_vector<T, Alloc, Growth>::iterator_t<TT>::seek(std::size_t idx) noexcept
+{
+    if (first_block == nullptr)
+    {
+        return;
+    }
+    if (idx == 0)
+    {
+        enter_block(first_block);
+        return;
+    }
+    // Locate the element before, since idx may be the end of the last block,
+    // and then step forward the same way operator++ does.
+    const auto id = Growth::block_id(idx - 1);
+    enter_block(first_block + id);
+    current_element += idx - Growth::block_start(id);
+    if (current_element == block_end && current_block[1] != nullptr)
+    {
+        enter_block(current_block + 1);
+    }
+}
+
+template <typename T, typename Alloc, typename Growth> template <typename TT>
+void stable_vector<T, Alloc, Growth>::iterator_t<TT>::enter_block(const block_pointer* b) noexcept
+{
+    current_block = b;
+    current_element = *b;
+    block_end = current_element
+        + Growth::block_size(static_cast<std::size_t>(b - first_block));
+}
+
+// Algorithms that loop over each block separately. They give the same
+// result as their std:: counterparts over [begin(), end()).
+
+template <typename T, typename Alloc, typename Growth, typename F>
+auto for_each(stable_vector<T, Alloc, Growth>& v, F f) -> F
+{
+    for (auto segment : v.segments())
+    {
+        std::for_each(segment.begin(), segment.end(), std::ref(f));
+    }
+    return f;
+}
+
+template <typename T, typename Alloc, typename Growth, typename F>
+auto for_each(const stable_vector<T, Alloc, Growth>& v, F f) -> F
+{
+    for (auto segment : v.segments())
+    {
+        std::for_each(segment.begin(), segment.end(), std::ref(f));
+    }
+    return f;
+}
+
+template <typename T, typename Alloc, typename Growth, std::weakly_incrementable O>
+auto copy(const stable_vector<T, Alloc, Growth>& v, O out) -> O
+{
+    for (auto segment : v.segments())
+    {
+        out = std::copy(segment.begin(), segment.end(), std::move(out));
+    }
+    return out;
+}
+
+template <typename T, typename Alloc, typename Growth, typename U>
+void fill(stable_vector<T, Alloc, Growth>& v, const U& value)
+{
+    for (auto segment : v.segments())
+    {
+        std::fill(segment.begin(), segment.end(), value);
+    }
+}
+
+template <typename T, typename Alloc, typename Growth, std::weakly_incrementable O, typename F>
+auto transform(const stable_vector<T, Alloc, Growth>& v, O out, F f) -> O
+{
+    for (auto segment : v.segments())
+    {
+        out = std::transform(segment.begin(), segment.end(), std::move(out), std::ref(f));
+    }
+    return out;
+}
+
+template <typename T, typename Alloc, typename Growth, typename U, typename Op = std::plus<>>
+auto accumulate(const stable_vector<T, Alloc, Growth>& v, U init, Op op = {}) -> U
+{
+    for (auto segment : v.segments())
+    {
+        init = std::accumulate(segment.begin(), segment.end(), std::move(init), std::ref(op));
+    }
+    return init;
+}
+
+template <typename T, typename Alloc, typename Growth, typename U>
+auto find(stable_vector<T, Alloc, Growth>& v, const U& value)
+-> typename stable_vector<T, Alloc, Growth>::iterator
+{
+    std::ptrdiff_t offset = 0;
+    for (auto segment : v.segments())
+    {
+        const auto i = std::find(segment.begin(), segment.end(), value);
+        if (i != segment.end())
+        {
+            return v.begin() + (offset + (i - segment.begin()));
+        }
+        offset += std::ssize(segment);
+    }
+    return v.end();
+}
+
+template <typename T, typename Alloc, typename Growth, typename U>
+auto find(const stable_vector<T, Alloc, Growth>& v, const U& value)
+-> typename stable_vector<T, Alloc, Growth>::const_iterator
+{
+    std::ptrdiff_t offset = 0;
+    for (auto segment : v.segments())
+    {
+        const auto i = std::find(segment.begin(), segment.end(), value);
+        if (i != segment.end())
+        {
+            return v.begin() + (offset + (i - segment.begin()));
+        }
+        offset += std::ssize(segment);
+    }
+    return v.end();
+}
+
+template <typename T, typename Alloc, typename Growth, typename U>
+auto count(const stable_vector<T, Alloc, Growth>& v, const U& value) -> std::ptrdiff_t
+{
+    std::ptrdiff_t rv = 0;
+    for (auto segment : v.segments())
+    {
+        rv += std::count(segment.begin(), segment.end(), value);
+    }
+    return rv;
+}
+
+// Removes all elements for which pred is true in one pass, keeping the
+// order of the others, and returns the number of removed elements. The
+// kept elements are moved down block by block, and the emptied blocks at
+// the end are released together.
+template <typename T, typename Alloc, typename Growth, typename Pred>
+auto erase_if(stable_vector<T, Alloc, Growth>& v, Pred pred) -> std::size_t
+requires std::is_move_assignable_v<T>
+{
+    auto segments = v.segments();
+    auto out_segment = segments.begin();
+    T* out = nullptr;
+    T* out_end = nullptr;
+    if (out_segment != segments.end())
+    {
+        out = (*out_segment).data();
+        out_end = out + (*out_segment).size();
+    }
+    std::size_t kept = 0;
+    for (auto segment : segments)
+    {
+        for (auto& e : segment)
+        {
+            if (pred(e))
+            {
+                continue;
+            }
+            if (out == out_end)
+            {
+                ++out_segment;
+                out = (*out_segment).data();
+                out_end = out + (*out_segment).size();
+            }
+            if (out != &e)
+            {
+                *out = std::move(e);
+            }
+            ++out;
+            ++kept;
+        }
+    }
+    const auto removed = v.size() - kept;
+    v.truncate(kept);
+    return removed;
+}
+
+template <typename T, typename Alloc, typename Growth, typename U>
+auto erase(stable_vector<T, Alloc, Growth>& v, const U& value) -> std::size_t
+requires std::is_move_assignable_v<T>
 {
+    return erase_if(v, [&value](const auto& e) { return e == value; });
 }
 
 namespace pmr
 {
-template <typename T>
-using stable_vector = ::stable_vector<T, std::pmr::polymorphic_allocator<T>>;
+template <typename T, typename Growth = power_of_two_growth<>>
+using stable_vector = ::stable_vector<T, std::pmr::polymorphic_allocator<T>, Growth>;
 }
 
-template <typename T, typename Alloc, typename A2>
-stable_vector(stable_vector<T, Alloc>, A2) -> stable_vector<T, Alloc>;
+template <typename T, typename Alloc, typename Growth, typename A2>
+stable_vector(stable_vector<T, Alloc, Growth>, A2) -> stable_vector<T, Alloc, Growth>;
 
 template <std::ranges::range R, typename A = std::allocator<typename R::value_type>>
 stable_vector(R, A = {}) -> stable_vector<typename R::value_type, A>;
@@ -0,0 +1,157 @@
+#ifndef STABLE_VECTOR_STABLE_VECTOR_IO_HPP_INCLUDED
+#define STABLE_VECTOR_STABLE_VECTOR_IO_HPP_INCLUDED
+
+#if __has_include(<sys/uio.h>)
+
+#include "stable_vector.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Writes and reads the elements of a vector of trivially copyable types
+// as their bytes, with one iovec per block, so a whole vector goes to or
+// from a file descriptor in one writev() or readv() call. Loads allocate
+// the blocks first and read straight into them.
+//
+// For callers that do their own I/O, such as with io_uring, the iovecs
+// are available too.
+
+#ifdef IOV_MAX
+inline constexpr std::size_t stable_vector_iov_max = IOV_MAX;
+#else
+inline constexpr std::size_t stable_vector_iov_max = 1024;
+#endif
+
+// One iovec per span of storage. iovec has no const version, so the
+// iovecs of const elements are only for writing them out.
+template <typename T>
+auto stable_vector_iovecs(const std::vector<std::span<T>>& storage) -> std::vector<::iovec>
+{
+    std::vector<::iovec> rv;
+    rv.reserve(storage.size());
+    for (auto s : storage)
+    {
+        rv.push_back({const_cast<std::remove_const_t<T>*>(s.data()), s.size_bytes()});
+    }
+    return rv;
+}
+
+// Call io(fd, iovecs, count) until all of iovecs is transferred, in
+// batches of at most IOV_MAX, continuing after short transfers. A call
+// that transfers nothing throws std::runtime_error with the message
+// no_progress, since it would do so again.
+template <typename F>
+void stable_vector_transfer(int fd, std::span<::iovec> iovecs, F io, const char* what, const char* no_progress)
+{
+    while (!iovecs.empty())
+    {
+        const auto count = std::min(iovecs.size(), stable_vector_iov_max);
+        const auto done = io(fd, iovecs.data(), static_cast<int>(count));
+        if (done < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+        if (done == 0)
+        {
+            throw std::runtime_error(no_progress);
+        }
+        auto left = static_cast<std::size_t>(done);
+        while (!iovecs.empty() && left >= iovecs.front().iov_len)
+        {
+            left -= iovecs.front().iov_len;
+            iovecs = iovecs.subspan(1);
+        }
+        if (left != 0)
+        {
+            auto& front = iovecs.front();
+            front.iov_base = static_cast<std::byte*>(front.iov_base) + left;
+            front.iov_len -= left;
+        }
+    }
+}
+
+// One iovec per block, over the bytes of the elements, to write them out.
+// They are valid until the vector is changed.
+template <typename T, typename Alloc, typename Growth>
+requires std::is_trivially_copyable_v<T>
+auto dump_iovecs(const stable_vector<T, Alloc, Growth>& v) -> std::vector<::iovec>
+{
+    return stable_vector_iovecs(stable_vector_detail::storage_access::storage(v, 0, v.size()));
+}
+
+// Allocates room for n more elements, and returns one iovec per block
+// over their storage, to read their bytes into. Once they are read,
+// commit_load(v, n) appends them, or if the read fails, abort_load(v)
+// releases the room. The vector must not be changed in between.
+template <typename T, typename Alloc, typename Growth>
+requires std::is_trivially_copyable_v<T>
+auto load_iovecs(stable_vector<T, Alloc, Growth>& v, std::size_t n) -> std::vector<::iovec>
+{
+    using access = stable_vector_detail::storage_access;
+    access::allocate(v, v.size() + n);
+    return stable_vector_iovecs(access::storage(v, v.size(), v.size() + n));
+}
+
+template <typename T, typename Alloc, typename Growth>
+requires std::is_trivially_copyable_v<T>
+void commit_load(stable_vector<T, Alloc, Growth>& v, std::size_t n) noexcept
+{
+    stable_vector_detail::storage_access::commit(v, n);
+}
+
+// Releases the blocks allocated by load_iovecs(), other than those
+// reserved and a spare one, and leaves the elements as they were.
+template <typename T, typename Alloc, typename Growth>
+requires std::is_trivially_copyable_v<T>
+void abort_load(stable_vector<T, Alloc, Growth>& v) noexcept
+{
+    stable_vector_detail::storage_access::release_unused(v);
+}
+
+// Writes the bytes of the elements to fd. Throws std::system_error if the
+// write fails, and std::runtime_error if fd takes no more bytes, after
+// writing an unknown part of them.
+template <typename T, typename Alloc, typename Growth>
+requires std::is_trivially_copyable_v<T>
+void dump_to(int fd, const stable_vector<T, Alloc, Growth>& v)
+{
+    auto iovecs = dump_iovecs(v);
+    stable_vector_transfer(fd, iovecs, ::writev, "writev", "stable_vector: writev wrote nothing");
+}
+
+// Reads n elements from fd and appends them. Throws std::system_error if
+// the read fails, and std::runtime_error if fd ends before n elements;
+// the vector is then left as it was.
+template <typename T, typename Alloc, typename Growth>
+requires std::is_trivially_copyable_v<T>
+void load_from(int fd, stable_vector<T, Alloc, Growth>& v, std::size_t n)
+{
+    auto iovecs = load_iovecs(v, n);
+    try {
+        stable_vector_transfer(fd, iovecs, ::readv, "readv", "stable_vector: unexpected end of file");
+    }
+    catch (...)
+    {
+        abort_load(v);
+        throw;
+    }
+    commit_load(v, n);
+}
+
+#endif
+
+#endif //STABLE_VECTOR_STABLE_VECTOR_IO_HPP_INCLUDED
@@ -0,0 +1,704 @@
+#ifndef STABLE_VECTOR_STABLE_VECTOR_PARALLEL_HPP_INCLUDED
+#define STABLE_VECTOR_STABLE_VECTOR_PARALLEL_HPP_INCLUDED
+
+#include "stable_vector.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// A pool of worker threads, each with a queue of its own. Workers take
+// work from the back of their own queue, and steal from the front of the
+// other queues when their own is empty. The thread that waits for a batch
+// of work runs tasks too, so a pool without workers runs everything on
+// the calling thread.
+class work_stealing_pool
+{
+public:
+    explicit work_stealing_pool(std::size_t workers = default_workers());
+
+    work_stealing_pool(const work_stealing_pool&) = delete;
+    auto operator=(const work_stealing_pool&) -> work_stealing_pool& = delete;
+
+    ~work_stealing_pool();
+
+    [[nodiscard]]
+    auto size() const noexcept -> std::size_t;
+
+    // Call f(i) for every i in [0, count), and return when all calls are
+    // done. The first exception thrown by a call is rethrown here.
+    template <typename F>
+    void run(std::size_t count, F&& f);
+
+    [[nodiscard]]
+    static auto default_pool() -> work_stealing_pool&;
+
+    [[nodiscard]]
+    static auto default_workers() noexcept -> std::size_t;
+private:
+    struct batch
+    {
+        void (*invoke)(void*, std::size_t);
+        void* function;
+        std::atomic<std::size_t> remaining;
+        std::mutex error_mutex;
+        std::exception_ptr error;
+    };
+
+    struct task
+    {
+        batch* owner;
+        std::size_t index;
+    };
+
+    struct queue
+    {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    void shut_down() noexcept;
+    void work(std::size_t id);
+    auto try_run_one(std::size_t first) -> bool;
+    static void execute(task t) noexcept;
+
+    std::vector<queue> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<std::size_t> pending_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    bool stop_ = false;
+};
+
+inline work_stealing_pool::work_stealing_pool(std::size_t workers)
+    : queues_(workers)
+{
+    workers_.reserve(workers);
+    try {
+        for (std::size_t id = 0; id != workers; ++id)
+        {
+            workers_.emplace_back([this, id] { work(id); });
+        }
+    }
+    catch (...)
+    {
+        shut_down();
+        throw;
+    }
+}
+
+inline work_stealing_pool::~work_stealing_pool()
+{
+    shut_down();
+}
+
+inline void work_stealing_pool::shut_down() noexcept
+{
+    {
+        std::lock_guard lock(sleep_mutex_);
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+inline auto work_stealing_pool::size() const noexcept -> std::size_t
+{
+    return workers_.size();
+}
+
+template <typename F>
+void work_stealing_pool::run(std::size_t count, F&& f)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (workers_.empty() || count == 1)
+    {
+        for (std::size_t i = 0; i != count; ++i)
+        {
+            f(i);
+        }
+        return;
+    }
+    using function_type = std::remove_reference_t<F>;
+    batch b{
+        [](void* p, std::size_t i) { (*static_cast<function_type*>(p))(i); },
+        const_cast<void*>(static_cast<const void*>(std::addressof(f))),
+        count,
+        {},
+        {}
+    };
+    // If queueing a task throws, the tasks already queued point at the
+    // batch, so they are run to completion before the exception leaves.
+    std::size_t queued = 0;
+    std::exception_ptr queue_error;
+    try {
+        for (; queued != count; ++queued)
+        {
+            auto& q = queues_[queued % queues_.size()];
+            std::lock_guard lock(q.mutex);
+            q.tasks.push_back({&b, queued});
+        }
+    }
+    catch (...)
+    {
+        queue_error = std::current_exception();
+        b.remaining.fetch_sub(count - queued, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard lock(sleep_mutex_);
+        pending_ += queued;
+    }
+    sleep_cv_.notify_all();
+    while (b.remaining.load(std::memory_order_acquire) != 0)
+    {
+        if (!try_run_one(0))
+        {
+            std::this_thread::yield();
+        }
+    }
+    if (queue_error)
+    {
+        std::rethrow_exception(queue_error);
+    }
+    if (b.error)
+    {
+        std::rethrow_exception(b.error);
+    }
+}
+
+inline auto work_stealing_pool::default_pool() -> work_stealing_pool&
+{
+    static work_stealing_pool pool;
+    return pool;
+}
+
+inline auto work_stealing_pool::default_workers() noexcept -> std::size_t
+{
+    const auto cores = std::thread::hardware_concurrency();
+    // the thread waiting for a batch is busy too
+    return cores > 1 ? cores - 1 : 0;
+}
+
+inline void work_stealing_pool::work(std::size_t id)
+{
+    for (;;)
+    {
+        if (try_run_one(id))
+        {
+            continue;
+        }
+        std::unique_lock lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this] { return stop_ || pending_.load() != 0; });
+        if (stop_ && pending_.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+inline auto work_stealing_pool::try_run_one(std::size_t first) -> bool
+{
+    std::optional<task> t;
+    {
+        auto& own = queues_[first];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            t = own.tasks.back();
+            own.tasks.pop_back();
+        }
+    }
+    for (std::size_t n = 1; !t && n != queues_.size(); ++n)
+    {
+        auto& victim = queues_[(first + n) % queues_.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            t = victim.tasks.front();
+            victim.tasks.pop_front();
+        }
+    }
+    if (!t)
+    {
+        return false;
+    }
+    --pending_;
+    execute(*t);
+    return true;
+}
+
+inline void work_stealing_pool::execute(task t) noexcept
+{
+    auto& b = *t.owner;
+    try {
+        b.invoke(b.function, t.index);
+    }
+    catch (...)
+    {
+        std::lock_guard lock(b.error_mutex);
+        if (!b.error)
+        {
+            b.error = std::current_exception();
+        }
+    }
+    // last access to the batch, which lives on the stack of run()
+    b.remaining.fetch_sub(1, std::memory_order_release);
+}
+
+// A contiguous part of a block, and the index of its first element.
+template <typename TT>
+struct stable_vector_chunk
+{
+    std::span<TT> elements;
+    std::size_t start;
+};
+
+// Split the vector along its blocks, and split blocks larger than grain
+// elements further. Split points inside a block are moved to the start
+// of a cache line when possible, so that no two chunks share one.
+template <typename Segments>
+auto stable_vector_chunks(Segments&& segments, std::size_t grain)
+{
+    using span_type = std::ranges::range_value_t<Segments>;
+    using element_type = typename span_type::element_type;
+    constexpr std::size_t cache_line = 64;
+    std::vector<stable_vector_chunk<element_type>> rv;
+    std::size_t start = 0;
+    for (span_type segment : segments)
+    {
+        while (segment.size() > grain)
+        {
+            auto split = grain;
+            if constexpr (cache_line % sizeof(element_type) == 0)
+            {
+                const auto address = reinterpret_cast<std::uintptr_t>(segment.data() + split);
+                const auto misalignment = (address % cache_line) / sizeof(element_type);
+                if (misalignment < split)
+                {
+                    split -= misalignment;
+                }
+            }
+            rv.push_back({segment.first(split), start});
+            start += split;
+            segment = segment.subspan(split);
+        }
+        rv.push_back({segment, start});
+        start += segment.size();
+    }
+    return rv;
+}
+
+template <typename T>
+constexpr auto stable_vector_default_grain() noexcept -> std::size_t
+{
+    constexpr std::size_t bytes = 64 * 1024;
+    return sizeof(T) < bytes ? bytes / sizeof(T) : 1;
+}
+
+template <typename T, typename Alloc, typename Growth, typename F>
+void parallel_for_each(work_stealing_pool& pool, stable_vector<T, Alloc, Growth>& v, F f)
+{
+    const auto chunks = stable_vector_chunks(v.segments(), stable_vector_default_grain<T>());
+    pool.run(chunks.size(), [&](std::size_t i) {
+        std::for_each(chunks[i].elements.begin(), chunks[i].elements.end(), std::ref(f));
+    });
+}
+
+template <typename T, typename Alloc, typename Growth, typename F>
+void parallel_for_each(work_stealing_pool& pool, const stable_vector<T, Alloc, Growth>& v, F f)
+{
+    const auto chunks = stable_vector_chunks(v.segments(), stable_vector_default_grain<T>());
+    pool.run(chunks.size(), [&](std::size_t i) {
+        std::for_each(chunks[i].elements.begin(), chunks[i].elements.end(), std::ref(f));
+    });
+}
+
+template <typename V, typename F>
+auto parallel_for_each(V& v, F f)
+-> decltype(parallel_for_each(std::declval<work_stealing_pool&>(), v, std::move(f)))
+{
+    return parallel_for_each(work_stealing_pool::default_pool(), v, std::move(f));
+}
+
+// Reduce each chunk with op(U, element), in element order, and combine
+// the results of the chunks, in element order, with combine(U, U). The
+// first chunk starts from init, so that init is used exactly once, and
+// every other chunk starts from seed(element) of its first element.
+template <typename T, typename Alloc, typename Growth, typename U, typename Seed, typename Op, typename Combine>
+auto stable_vector_reduce(work_stealing_pool& pool,
+                          const stable_vector<T, Alloc, Growth>& v,
+                          U init,
+                          Seed seed,
+                          Op op,
+                          Combine combine)
+-> U
+{
+    const auto chunks = stable_vector_chunks(v.segments(), stable_vector_default_grain<T>());
+    if (chunks.empty())
+    {
+        return init;
+    }
+    std::vector<std::optional<U>> partials(chunks.size());
+    pool.run(chunks.size(), [&](std::size_t i) {
+        auto elements = chunks[i].elements;
+        if (i != 0 && elements.empty())
+        {
+            return;
+        }
+        // only the task of the first chunk touches init
+        U acc = i == 0 ? std::move(init) : seed(elements.front());
+        if (i != 0)
+        {
+            elements = elements.subspan(1);
+        }
+        for (const auto& element : elements)
+        {
+            acc = op(std::move(acc), element);
+        }
+        partials[i].emplace(std::move(acc));
+    });
+    U rv = std::move(*partials.front());
+    for (std::size_t i = 1; i != partials.size(); ++i)
+    {
+        if (partials[i])
+        {
+            rv = combine(std::move(rv), std::move(*partials[i]));
+        }
+    }
+    return rv;
+}
+
+// Reduce with op, as std::reduce does: init is used once, and op must be
+// associative, and accept any mix of U and elements. Chunks other than
+// the first start from their first element, converted to U.
+template <typename T, typename Alloc, typename Growth, typename U, typename Op = std::plus<>>
+auto parallel_reduce(work_stealing_pool& pool, const stable_vector<T, Alloc, Growth>& v, U init, Op op = {})
+-> U
+{
+    return stable_vector_reduce(pool, v, std::move(init), [](const T& t) { return U(t); }, op, op);
+}
+
+// Reduce with op(U, element), such as a count of matches, and combine the
+// results of the chunks with combine(U, U), which must be associative.
+// init is used once. Chunks other than the first start from
+// op(U{}, element) of their first element, so a value initialized U must
+// be an identity of combine.
+template <typename T, typename Alloc, typename Growth, typename U, typename Op, typename Combine>
+auto parallel_reduce(work_stealing_pool& pool,
+                     const stable_vector<T, Alloc, Growth>& v,
+                     U init,
+                     Op op,
+                     Combine combine)
+-> U
+{
+    return stable_vector_reduce(pool, v, std::move(init), [&](const T& t) { return op(U{}, t); }, op,
+                                std::move(combine));
+}
+
+template <typename T, typename Alloc, typename Growth, typename U, typename Op, typename Combine>
+auto parallel_reduce(const stable_vector<T, Alloc, Growth>& v, U init, Op op, Combine combine) -> U
+{
+    return parallel_reduce(work_stealing_pool::default_pool(), v, std::move(init), std::move(op),
+                           std::move(combine));
+}
+
+template <typename T, typename Alloc, typename Growth, typename U, typename Op = std::plus<>>
+auto parallel_reduce(const stable_vector<T, Alloc, Growth>& v, U init, Op op = {}) -> U
+{
+    return parallel_reduce(work_stealing_pool::default_pool(), v, std::move(init), std::move(op));
+}
+
+// Write f(v[i]) to out[i]. out must be a random access iterator to a
+// range of at least v.size() elements.
+template <typename T, typename Alloc, typename Growth, std::random_access_iterator O, typename F>
+auto parallel_transform(work_stealing_pool& pool, const stable_vector<T, Alloc, Growth>& v, O out, F f)
+-> O
+{
+    const auto chunks = stable_vector_chunks(v.segments(), stable_vector_default_grain<T>());
+    pool.run(chunks.size(), [&](std::size_t i) {
+        const auto& chunk = chunks[i];
+        std::transform(chunk.elements.begin(), chunk.elements.end(),
+                       out + static_cast<std::iter_difference_t<O>>(chunk.start),
+                       std::ref(f));
+    });
+    return out + static_cast<std::iter_difference_t<O>>(v.size());
+}
+
+template <typename T, typename Alloc, typename Growth, std::random_access_iterator O, typename F>
+auto parallel_transform(const stable_vector<T, Alloc, Growth>& v, O out, F f) -> O
+{
+    return parallel_transform(work_stealing_pool::default_pool(), v, std::move(out), std::move(f));
+}
+
+// Write the inclusive prefix sums of v, using op, to out. out may be
+// v.begin() for an in place scan. Op must be associative.
+template <typename T, typename Alloc, typename Growth, std::random_access_iterator O, typename Op = std::plus<>>
+auto parallel_inclusive_scan(work_stealing_pool& pool, const stable_vector<T, Alloc, Growth>& v, O out, Op op = {})
+-> O
+{
+    const auto chunks = stable_vector_chunks(v.segments(), stable_vector_default_grain<T>());
+    std::vector<std::optional<T>> carry(chunks.size());
+    pool.run(chunks.size(), [&](std::size_t i) {
+        if (i + 1 == chunks.size())
+        {
+            return;
+        }
+        const auto elements = chunks[i].elements;
+        T acc = elements.front();
+        for (auto it = elements.begin() + 1; it != elements.end(); ++it)
+        {
+            acc = op(std::move(acc), *it);
+        }
+        carry[i + 1].emplace(std::move(acc));
+    });
+    for (std::size_t i = 2; i < carry.size(); ++i)
+    {
+        carry[i].emplace(op(*carry[i - 1], std::move(*carry[i])));
+    }
+    pool.run(chunks.size(), [&](std::size_t i) {
+        const auto& chunk = chunks[i];
+        auto dest = out + static_cast<std::iter_difference_t<O>>(chunk.start);
+        auto it = chunk.elements.begin();
+        T acc = carry[i] ? op(*carry[i], *it) : T(*it);
+        for (;;)
+        {
+            *dest = acc;
+            if (++it == chunk.elements.end())
+            {
+                break;
+            }
+            ++dest;
+            acc = op(std::move(acc), *it);
+        }
+    });
+    return out + static_cast<std::iter_difference_t<O>>(v.size());
+}
+
+template <typename T, typename Alloc, typename Growth, std::random_access_iterator O, typename Op = std::plus<>>
+auto parallel_inclusive_scan(const stable_vector<T, Alloc, Growth>& v, O out, Op op = {}) -> O
+{
+    return parallel_inclusive_scan(work_stealing_pool::default_pool(), v, std::move(out), std::move(op));
+}
+
+struct stable_vector_parallel_access
+{
+    using storage_access = stable_vector_detail::storage_access;
+
+    // Append n elements, constructed in parallel by construct(storage, start)
+    // for the chunks of the storage after the last element, where start is
+    // the index of the chunk among the new elements. construct must leave
+    // nothing constructed when it throws, and then the vector is unchanged.
+    template <typename T, typename Alloc, typename Growth, typename F>
+    static void append(work_stealing_pool& pool, stable_vector<T, Alloc, Growth>& v, std::size_t n, F construct)
+    {
+        const auto old_size = v.size();
+        // the blocks allocated before a failure are released, as for a
+        // failed append
+        try {
+            storage_access::allocate(v, old_size + n);
+            const auto chunks = stable_vector_chunks(storage_access::storage(v, old_size, old_size + n),
+                                                     stable_vector_default_grain<T>());
+            std::vector<unsigned char> done(chunks.size());
+            try {
+                pool.run(chunks.size(), [&](std::size_t i) {
+                    construct(chunks[i].elements, chunks[i].start);
+                    done[i] = true;
+                });
+            }
+            catch (...)
+            {
+                for (std::size_t i = 0; i != chunks.size(); ++i)
+                {
+                    if (done[i])
+                    {
+                        std::destroy(chunks[i].elements.begin(), chunks[i].elements.end());
+                    }
+                }
+                throw;
+            }
+        }
+        catch (...)
+        {
+            storage_access::release_unused(v);
+            throw;
+        }
+        storage_access::commit(v, n);
+    }
+
+    // Destroy the elements from index n on in parallel, and remove them.
+    template <typename T, typename Alloc, typename Growth>
+    static void destroy(work_stealing_pool& pool, stable_vector<T, Alloc, Growth>& v, std::size_t n)
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            const auto chunks = stable_vector_chunks(storage_access::storage(v, n, v.size()),
+                                                     stable_vector_default_grain<T>());
+            pool.run(chunks.size(), [&](std::size_t i) {
+                std::destroy(chunks[i].elements.begin(), chunks[i].elements.end());
+            });
+        }
+        storage_access::forget(v, n);
+    }
+
+    // Construct the elements of storage from ts, or value initialized if
+    // there are none, using allocator for types that use one.
+    template <typename T, typename Alloc, typename ... Ts>
+    static void construct_copies(std::span<T> storage, const Alloc& allocator, const Ts& ... ts)
+    {
+        if constexpr (!std::uses_allocator_v<T, Alloc> && sizeof...(Ts) == 0)
+        {
+            std::uninitialized_value_construct(storage.begin(), storage.end());
+        }
+        else if constexpr (!std::uses_allocator_v<T, Alloc>)
+        {
+            std::uninitialized_fill(storage.begin(), storage.end(), ts...);
+        }
+        else
+        {
+            construct_each(storage, [&](T* p) {
+                std::uninitialized_construct_using_allocator<T>(p, allocator, ts...);
+            });
+        }
+    }
+
+    // Construct the elements of storage from the ones at source.
+    template <typename T, typename Alloc>
+    static void construct_from(std::span<T> storage, const Alloc& allocator, const T* source)
+    {
+        if constexpr (std::is_trivially_copyable_v<T> && !std::uses_allocator_v<T, Alloc>)
+        {
+            std::memcpy(storage.data(), source, storage.size_bytes());
+        }
+        else if constexpr (!std::uses_allocator_v<T, Alloc>)
+        {
+            std::uninitialized_copy_n(source, storage.size(), storage.begin());
+        }
+        else
+        {
+            construct_each(storage, [&](T* p) {
+                std::uninitialized_construct_using_allocator<T>(p, allocator, *source++);
+            });
+        }
+    }
+
+    template <typename T, typename F>
+    static void construct_each(std::span<T> storage, F construct_at)
+    {
+        auto p = storage.data();
+        try {
+            for (; p != storage.data() + storage.size(); ++p)
+            {
+                construct_at(p);
+            }
+        }
+        catch (...)
+        {
+            std::destroy(storage.data(), p);
+            throw;
+        }
+    }
+};
+
+// Copy source, constructing the copy block by block on the threads of the
+// pool. Each part of the copy is first written by the thread that
+// constructs it, which on NUMA systems places its pages near that thread.
+template <typename T, typename Alloc, typename Growth>
+auto parallel_copy(work_stealing_pool& pool, const stable_vector<T, Alloc, Growth>& source)
+-> stable_vector<T, Alloc, Growth>
+requires std::is_copy_constructible_v<T>
+{
+    using access = stable_vector_parallel_access;
+    const auto allocator = std::allocator_traits<Alloc>::select_on_container_copy_construction(source.get_allocator());
+    stable_vector<T, Alloc, Growth> copy(allocator);
+    // The copy has the blocks of the source, so every chunk of its storage
+    // lies within one block of the source too.
+    access::append(pool, copy, source.size(), [&](std::span<T> storage, std::size_t start) {
+        access::construct_from(storage, allocator, std::addressof(source[start]));
+    });
+    return copy;
+}
+
+template <typename T, typename Alloc, typename Growth>
+auto parallel_copy(const stable_vector<T, Alloc, Growth>& source) -> stable_vector<T, Alloc, Growth>
+requires std::is_copy_constructible_v<T>
+{
+    return parallel_copy(work_stealing_pool::default_pool(), source);
+}
+
+// Like v.resize(n) and v.resize(n, value), with the elements constructed
+// or destroyed on the threads of the pool.
+template <typename T, typename Alloc, typename Growth>
+void parallel_resize(work_stealing_pool& pool, stable_vector<T, Alloc, Growth>& v, std::size_t n)
+requires std::is_default_constructible_v<T>
+{
+    using access = stable_vector_parallel_access;
+    if (n < v.size())
+    {
+        access::destroy(pool, v, n);
+        return;
+    }
+    const auto allocator = v.get_allocator();
+    access::append(pool, v, n - v.size(), [&](std::span<T> storage, std::size_t) {
+        access::construct_copies(storage, allocator);
+    });
+}
+
+template <typename T, typename Alloc, typename Growth>
+void parallel_resize(work_stealing_pool& pool, stable_vector<T, Alloc, Growth>& v, std::size_t n, const T& value)
+requires std::is_copy_constructible_v<T>
+{
+    using access = stable_vector_parallel_access;
+    if (n < v.size())
+    {
+        access::destroy(pool, v, n);
+        return;
+    }
+    const auto allocator = v.get_allocator();
+    access::append(pool, v, n - v.size(), [&](std::span<T> storage, std::size_t) {
+        access::construct_copies(storage, allocator, value);
+    });
+}
+
+template <typename T, typename Alloc, typename Growth>
+void parallel_resize(stable_vector<T, Alloc, Growth>& v, std::size_t n)
+requires std::is_default_constructible_v<T>
+{
+    parallel_resize(work_stealing_pool::default_pool(), v, n);
+}
+
+template <typename T, typename Alloc, typename Growth>
+void parallel_resize(stable_vector<T, Alloc, Growth>& v, std::size_t n, const T& value)
+requires std::is_copy_constructible_v<T>
+{
+    parallel_resize(work_stealing_pool::default_pool(), v, n, value);
+}
+
+// Like v.clear(), with the elements destroyed on the threads of the pool.
+template <typename T, typename Alloc, typename Growth>
+void parallel_clear(work_stealing_pool& pool, stable_vector<T, Alloc, Growth>& v)
+{
+    stable_vector_parallel_access::destroy(pool, v, 0);
+    v.clear();
+}
+
+template <typename T, typename Alloc, typename Growth>
+void parallel_clear(stable_vector<T, Alloc, Growth>& v)
+{
+    parallel_clear(work_stealing_pool::default_pool(), v);
+}
+
+#endif //STABLE_VECTOR_STABLE_VECTOR_PARALLEL_HPP_INCLUDED
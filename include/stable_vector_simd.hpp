@@ -0,0 +1,605 @@
+#ifndef STABLE_VECTOR_STABLE_VECTOR_SIMD_HPP_INCLUDED
+#define STABLE_VECTOR_STABLE_VECTOR_SIMD_HPP_INCLUDED
+
+#include "stable_vector.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <span>
+#include <type_traits>
+
+// Vectorized sum, min, max, find, count and equal for vectors of
+// arithmetic types. Each block is contiguous, so the kernels run over one
+// block at a time with the widest vectors the CPU supports, which is
+// detected once at run time. Elements at the end of a block that do not
+// fill a vector are handled one at a time.
+//
+// The vector kernels are written with the GCC/Clang vector extensions,
+// and are only used on x86. Elsewhere, and with other compilers, the
+// scalar standard algorithms are used.
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define STABLE_VECTOR_SIMD_X86 1
+#endif
+
+template <typename T>
+concept simd_element = std::is_arithmetic_v<T>
+    && !std::is_same_v<T, bool>
+    && !std::is_same_v<T, long double>;
+
+// Integers are added as unsigned, so that partial sums wrap around
+// instead of overflowing.
+template <typename T>
+using simd_sum_type = typename std::conditional_t<std::is_integral_v<T>,
+                                                  std::make_unsigned<T>,
+                                                  std::type_identity<T>>::type;
+
+enum class simd_level
+{
+    scalar,
+    sse2,
+    avx2,
+    avx512
+};
+
+// The widest level the CPU and the OS support.
+[[nodiscard]]
+inline auto simd_level_supported() noexcept -> simd_level
+{
+#ifdef STABLE_VECTOR_SIMD_X86
+    static const auto level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        {
+            return simd_level::avx512;
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return simd_level::avx2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return simd_level::sse2;
+        }
+        return simd_level::scalar;
+    }();
+    return level;
+#else
+    return simd_level::scalar;
+#endif
+}
+
+template <typename T>
+struct simd_scalar_kernels
+{
+    static auto sum(const T* p, std::size_t n) noexcept -> T
+    {
+        using sum_type = simd_sum_type<T>;
+        const auto rv = std::accumulate(p, p + n, sum_type{}, [](sum_type acc, T t) {
+            return static_cast<sum_type>(acc + static_cast<sum_type>(t));
+        });
+        return static_cast<T>(rv);
+    }
+
+    static auto min(const T* p, std::size_t n) noexcept -> T
+    {
+        return *std::min_element(p, p + n);
+    }
+
+    static auto max(const T* p, std::size_t n) noexcept -> T
+    {
+        return *std::max_element(p, p + n);
+    }
+
+    static auto find(const T* p, std::size_t n, T value) noexcept -> std::size_t
+    {
+        return static_cast<std::size_t>(std::find(p, p + n, value) - p);
+    }
+
+    static auto count(const T* p, std::size_t n, T value) noexcept -> std::size_t
+    {
+        return static_cast<std::size_t>(std::count(p, p + n, value));
+    }
+
+    static auto equal(const T* a, const T* b, std::size_t n) noexcept -> bool
+    {
+        return std::equal(a, a + n, b);
+    }
+};
+
+#ifdef STABLE_VECTOR_SIMD_X86
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+// vectors wider than the baseline are only passed between inlined functions
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+// The kernels for vectors of Bytes bytes. They are always inlined into
+// the functions below that are compiled for the instruction set of each
+// width.
+template <typename T, std::size_t Bytes>
+struct simd_vector_kernels
+{
+    typedef T vector __attribute__((vector_size(Bytes)));
+    using mask = decltype(vector{} == vector{});
+
+    static constexpr std::size_t lanes = Bytes / sizeof(T);
+
+    // Vectors are only passed by reference, since passing them by value
+    // to functions without the instruction set changes the ABI.
+    template <typename V>
+    [[gnu::always_inline]]
+    static inline void load(V& v, const T* p) noexcept
+    {
+        std::memcpy(&v, p, sizeof(v));
+    }
+
+    [[gnu::always_inline]]
+    static inline auto any(const mask& m) noexcept -> bool
+    {
+        std::uint64_t words[Bytes / sizeof(std::uint64_t)];
+        std::memcpy(words, &m, sizeof(m));
+        std::uint64_t rv = 0;
+        for (auto w : words)
+        {
+            rv |= w;
+        }
+        return rv != 0;
+    }
+
+    [[gnu::always_inline]]
+    static inline auto sum(const T* p, std::size_t n) noexcept -> T
+    {
+        // Four independent sums let the additions overlap.
+        using sum_type = simd_sum_type<T>;
+        typedef sum_type sum_vector __attribute__((vector_size(Bytes)));
+        sum_vector acc[4] = {};
+        sum_vector v;
+        std::size_t i = 0;
+        for (; i + 4 * lanes <= n; i += 4 * lanes)
+        {
+            for (std::size_t a = 0; a != 4; ++a)
+            {
+                load(v, p + i + a * lanes);
+                acc[a] += v;
+            }
+        }
+        for (; i + lanes <= n; i += lanes)
+        {
+            load(v, p + i);
+            acc[0] += v;
+        }
+        const sum_vector total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        sum_type rv{};
+        for (std::size_t l = 0; l != lanes; ++l)
+        {
+            rv = static_cast<sum_type>(rv + total[l]);
+        }
+        for (; i != n; ++i)
+        {
+            rv = static_cast<sum_type>(rv + static_cast<sum_type>(p[i]));
+        }
+        return static_cast<T>(rv);
+    }
+
+    // Every lane starts from the first element, and an element only
+    // replaces a smaller (or larger) one, so a NaN never replaces a value,
+    // and a NaN first element is never replaced, as with min_element()
+    // and max_element().
+    template <bool Max>
+    [[gnu::always_inline]]
+    static inline auto extreme(const T* p, std::size_t n) noexcept -> T
+    {
+        std::size_t i = 0;
+        T rv = p[0];
+        if (n >= lanes)
+        {
+            vector acc = vector{} + p[0];
+            vector v;
+            for (; i + lanes <= n; i += lanes)
+            {
+                load(v, p + i);
+                if constexpr (Max)
+                {
+                    acc = v > acc ? v : acc;
+                }
+                else
+                {
+                    acc = v < acc ? v : acc;
+                }
+            }
+            rv = acc[0];
+            for (std::size_t l = 1; l != lanes; ++l)
+            {
+                rv = Max ? std::max(rv, static_cast<T>(acc[l])) : std::min(rv, static_cast<T>(acc[l]));
+            }
+        }
+        for (; i != n; ++i)
+        {
+            rv = Max ? std::max(rv, p[i]) : std::min(rv, p[i]);
+        }
+        return rv;
+    }
+
+    [[gnu::always_inline]]
+    static inline auto min(const T* p, std::size_t n) noexcept -> T
+    {
+        return extreme<false>(p, n);
+    }
+
+    [[gnu::always_inline]]
+    static inline auto max(const T* p, std::size_t n) noexcept -> T
+    {
+        return extreme<true>(p, n);
+    }
+
+    [[gnu::always_inline]]
+    static inline auto find(const T* p, std::size_t n, T value) noexcept -> std::size_t
+    {
+        const vector needle = vector{} + value;
+        vector v;
+        std::size_t i = 0;
+        for (; i + lanes <= n; i += lanes)
+        {
+            load(v, p + i);
+            const mask m = v == needle;
+            if (any(m))
+            {
+                for (std::size_t l = 0;; ++l)
+                {
+                    if (m[l])
+                    {
+                        return i + l;
+                    }
+                }
+            }
+        }
+        for (; i != n && p[i] != value; ++i)
+        {
+        }
+        return i;
+    }
+
+    [[gnu::always_inline]]
+    static inline auto count(const T* p, std::size_t n, T value) noexcept -> std::size_t
+    {
+        const vector needle = vector{} + value;
+        vector v;
+        std::size_t rv = 0;
+        std::size_t i = 0;
+        while (i + lanes <= n)
+        {
+            // a match is -1 in its lane, and 64 of them fit in any lane
+            mask acc{};
+            const auto stop = std::min(n - n % lanes, i + 64 * lanes);
+            for (; i != stop; i += lanes)
+            {
+                load(v, p + i);
+                acc += v == needle;
+            }
+            for (std::size_t l = 0; l != lanes; ++l)
+            {
+                rv += static_cast<std::size_t>(-static_cast<std::int64_t>(acc[l]));
+            }
+        }
+        for (; i != n; ++i)
+        {
+            rv += p[i] == value;
+        }
+        return rv;
+    }
+
+    [[gnu::always_inline]]
+    static inline auto equal(const T* a, const T* b, std::size_t n) noexcept -> bool
+    {
+        vector va;
+        vector vb;
+        std::size_t i = 0;
+        for (; i + lanes <= n; i += lanes)
+        {
+            load(va, a + i);
+            load(vb, b + i);
+            if (any(va != vb))
+            {
+                return false;
+            }
+        }
+        return std::equal(a + i, a + n, b + i);
+    }
+};
+
+template <typename T>
+struct simd_sse2_kernels
+{
+    using kernels = simd_vector_kernels<T, 16>;
+
+    [[gnu::target("sse2")]]
+    static auto sum(const T* p, std::size_t n) noexcept -> T { return kernels::sum(p, n); }
+
+    [[gnu::target("sse2")]]
+    static auto min(const T* p, std::size_t n) noexcept -> T { return kernels::min(p, n); }
+
+    [[gnu::target("sse2")]]
+    static auto max(const T* p, std::size_t n) noexcept -> T { return kernels::max(p, n); }
+
+    [[gnu::target("sse2")]]
+    static auto find(const T* p, std::size_t n, T value) noexcept -> std::size_t
+    {
+        return kernels::find(p, n, value);
+    }
+
+    [[gnu::target("sse2")]]
+    static auto count(const T* p, std::size_t n, T value) noexcept -> std::size_t
+    {
+        return kernels::count(p, n, value);
+    }
+
+    [[gnu::target("sse2")]]
+    static auto equal(const T* a, const T* b, std::size_t n) noexcept -> bool
+    {
+        return kernels::equal(a, b, n);
+    }
+};
+
+template <typename T>
+struct simd_avx2_kernels
+{
+    using kernels = simd_vector_kernels<T, 32>;
+
+    [[gnu::target("avx2")]]
+    static auto sum(const T* p, std::size_t n) noexcept -> T { return kernels::sum(p, n); }
+
+    [[gnu::target("avx2")]]
+    static auto min(const T* p, std::size_t n) noexcept -> T { return kernels::min(p, n); }
+
+    [[gnu::target("avx2")]]
+    static auto max(const T* p, std::size_t n) noexcept -> T { return kernels::max(p, n); }
+
+    [[gnu::target("avx2")]]
+    static auto find(const T* p, std::size_t n, T value) noexcept -> std::size_t
+    {
+        return kernels::find(p, n, value);
+    }
+
+    [[gnu::target("avx2")]]
+    static auto count(const T* p, std::size_t n, T value) noexcept -> std::size_t
+    {
+        return kernels::count(p, n, value);
+    }
+
+    [[gnu::target("avx2")]]
+    static auto equal(const T* a, const T* b, std::size_t n) noexcept -> bool
+    {
+        return kernels::equal(a, b, n);
+    }
+};
+
+template <typename T>
+struct simd_avx512_kernels
+{
+    using kernels = simd_vector_kernels<T, 64>;
+
+    [[gnu::target("avx512f,avx512bw")]]
+    static auto sum(const T* p, std::size_t n) noexcept -> T { return kernels::sum(p, n); }
+
+    [[gnu::target("avx512f,avx512bw")]]
+    static auto min(const T* p, std::size_t n) noexcept -> T { return kernels::min(p, n); }
+
+    [[gnu::target("avx512f,avx512bw")]]
+    static auto max(const T* p, std::size_t n) noexcept -> T { return kernels::max(p, n); }
+
+    [[gnu::target("avx512f,avx512bw")]]
+    static auto find(const T* p, std::size_t n, T value) noexcept -> std::size_t
+    {
+        return kernels::find(p, n, value);
+    }
+
+    [[gnu::target("avx512f,avx512bw")]]
+    static auto count(const T* p, std::size_t n, T value) noexcept -> std::size_t
+    {
+        return kernels::count(p, n, value);
+    }
+
+    [[gnu::target("avx512f,avx512bw")]]
+    static auto equal(const T* a, const T* b, std::size_t n) noexcept -> bool
+    {
+        return kernels::equal(a, b, n);
+    }
+};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+// Call f with the kernels for level. A level the CPU does not support
+// must not be asked for.
+template <typename T, typename F>
+auto simd_dispatch(simd_level level, F f)
+{
+    switch (level)
+    {
+#ifdef STABLE_VECTOR_SIMD_X86
+    case simd_level::avx512:
+        return f(simd_avx512_kernels<T>{});
+    case simd_level::avx2:
+        return f(simd_avx2_kernels<T>{});
+    case simd_level::sse2:
+        return f(simd_sse2_kernels<T>{});
+#endif
+    default:
+        return f(simd_scalar_kernels<T>{});
+    }
+}
+
+// The kernels for one contiguous range. The level defaults to the widest
+// supported.
+
+// Floating point sums are added in a different order than by
+// std::accumulate, so the result may differ in rounding.
+template <simd_element T>
+auto simd_sum(std::span<const T> s, simd_level level = simd_level_supported()) noexcept -> T
+{
+    return simd_dispatch<T>(level, [s](auto k) { return k.sum(s.data(), s.size()); });
+}
+
+// s must not be empty.
+template <simd_element T>
+auto simd_min(std::span<const T> s, simd_level level = simd_level_supported()) noexcept -> T
+{
+    return simd_dispatch<T>(level, [s](auto k) { return k.min(s.data(), s.size()); });
+}
+
+// s must not be empty.
+template <simd_element T>
+auto simd_max(std::span<const T> s, simd_level level = simd_level_supported()) noexcept -> T
+{
+    return simd_dispatch<T>(level, [s](auto k) { return k.max(s.data(), s.size()); });
+}
+
+// The index of the first element equal to value, or s.size().
+template <simd_element T>
+auto simd_find(std::span<const T> s, T value, simd_level level = simd_level_supported()) noexcept
+-> std::size_t
+{
+    return simd_dispatch<T>(level, [s, value](auto k) { return k.find(s.data(), s.size(), value); });
+}
+
+template <simd_element T>
+auto simd_count(std::span<const T> s, T value, simd_level level = simd_level_supported()) noexcept
+-> std::size_t
+{
+    return simd_dispatch<T>(level, [s, value](auto k) { return k.count(s.data(), s.size(), value); });
+}
+
+// a and b must have the same size.
+template <simd_element T>
+auto simd_equal(std::span<const T> a, std::span<const T> b, simd_level level = simd_level_supported()) noexcept
+-> bool
+{
+    return simd_dispatch<T>(level, [a, b](auto k) { return k.equal(a.data(), b.data(), a.size()); });
+}
+
+// The same kernels over the blocks of a stable_vector, with the same
+// results as accumulate(), min_element(), max_element(), find(), count()
+// and ==. With NaNs, the min and max are those of min_element() and
+// max_element(): a NaN first element is the result, and other NaNs are
+// skipped. Of equal values, such as 0.0 and -0.0, either may be returned.
+
+template <simd_element T, typename Alloc, typename Growth>
+auto simd_sum(const stable_vector<T, Alloc, Growth>& v) noexcept -> T
+{
+    using sum_type = simd_sum_type<T>;
+    const auto level = simd_level_supported();
+    sum_type rv{};
+    for (std::span<const T> segment : v.segments())
+    {
+        rv = static_cast<sum_type>(rv + static_cast<sum_type>(simd_sum(segment, level)));
+    }
+    return static_cast<T>(rv);
+}
+
+// v must not be empty.
+template <simd_element T, typename Alloc, typename Growth>
+auto simd_min(const stable_vector<T, Alloc, Growth>& v) noexcept -> T
+{
+    const auto level = simd_level_supported();
+    T rv = v.front();
+    for (std::span<const T> segment : v.segments())
+    {
+        rv = std::min(rv, simd_min(segment, level));
+    }
+    return rv;
+}
+
+// v must not be empty.
+template <simd_element T, typename Alloc, typename Growth>
+auto simd_max(const stable_vector<T, Alloc, Growth>& v) noexcept -> T
+{
+    const auto level = simd_level_supported();
+    T rv = v.front();
+    for (std::span<const T> segment : v.segments())
+    {
+        rv = std::max(rv, simd_max(segment, level));
+    }
+    return rv;
+}
+
+template <simd_element T, typename Alloc, typename Growth>
+auto simd_find(stable_vector<T, Alloc, Growth>& v, T value) noexcept
+-> typename stable_vector<T, Alloc, Growth>::iterator
+{
+    const auto level = simd_level_supported();
+    std::ptrdiff_t offset = 0;
+    for (std::span<const T> segment : v.segments())
+    {
+        const auto i = simd_find(segment, value, level);
+        if (i != segment.size())
+        {
+            return v.begin() + (offset + static_cast<std::ptrdiff_t>(i));
+        }
+        offset += std::ssize(segment);
+    }
+    return v.end();
+}
+
+template <simd_element T, typename Alloc, typename Growth>
+auto simd_find(const stable_vector<T, Alloc, Growth>& v, T value) noexcept
+-> typename stable_vector<T, Alloc, Growth>::const_iterator
+{
+    const auto level = simd_level_supported();
+    std::ptrdiff_t offset = 0;
+    for (std::span<const T> segment : v.segments())
+    {
+        const auto i = simd_find(segment, value, level);
+        if (i != segment.size())
+        {
+            return v.begin() + (offset + static_cast<std::ptrdiff_t>(i));
+        }
+        offset += std::ssize(segment);
+    }
+    return v.end();
+}
+
+template <simd_element T, typename Alloc, typename Growth>
+auto simd_count(const stable_vector<T, Alloc, Growth>& v, T value) noexcept -> std::ptrdiff_t
+{
+    const auto level = simd_level_supported();
+    std::size_t rv = 0;
+    for (std::span<const T> segment : v.segments())
+    {
+        rv += simd_count(segment, value, level);
+    }
+    return static_cast<std::ptrdiff_t>(rv);
+}
+
+// Vectors with the same growth policy have blocks of the same sizes, so
+// their segments line up.
+template <simd_element T, typename Alloc, typename Growth>
+auto simd_equal(const stable_vector<T, Alloc, Growth>& a, const stable_vector<T, Alloc, Growth>& b) noexcept
+-> bool
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    const auto level = simd_level_supported();
+    const auto b_segments = b.segments();
+    auto bs = b_segments.begin();
+    for (std::span<const T> segment : a.segments())
+    {
+        if (!simd_equal(segment, std::span<const T>(*bs), level))
+        {
+            return false;
+        }
+        ++bs;
+    }
+    return true;
+}
+
+#endif //STABLE_VECTOR_STABLE_VECTOR_SIMD_HPP_INCLUDED